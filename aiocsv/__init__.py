@@ -1,3 +1,5 @@
+import sys
+
 __title__ = "aiocsv"
 __description__ = "Asynchronous CSV reading/writing"
 __version__ = "1.2.1"
@@ -10,5 +12,63 @@ __email__ = "".join(chr(i) for i in [109, 107, 117, 114, 97, 110, 111, 119, 115,
 __copyright__ = "© Copyright 2020-2021 Mikołaj Kuranowski"
 __license__ = "MIT"
 
-from .readers import AsyncReader, AsyncDictReader
-from .writers import AsyncWriter, AsyncDictWriter
+# Public names, and the modules they're defined in. Modules are only imported
+# when one of their names is first used, so that "import aiocsv" stays fast
+# (that's also why typing isn't imported here).
+TYPE_CHECKING = False
+
+_EXPORTS = {
+    "AsyncReader": "readers",
+    "AsyncDictReader": "readers",
+    "AsyncWriter": "writers",
+    "AsyncDictWriter": "writers",
+    "AsyncParallelWriter": "writers",
+    "parse_buffer": "parallel",
+    "transform": "pipeline",
+    "sort": "sorting",
+    "aggregate": "aggregation",
+    "join": "joining",
+    "load_table": "joining",
+    "LazyRow": "_parser",
+}
+
+__all__ = list(_EXPORTS)
+
+if TYPE_CHECKING:
+    from typing import List
+    from .readers import AsyncReader, AsyncDictReader
+    from .writers import AsyncWriter, AsyncDictWriter, AsyncParallelWriter
+    from .parallel import parse_buffer
+    from .pipeline import transform
+    from .sorting import sort
+    from .aggregation import aggregate
+    from .joining import join, load_table
+    from ._parser import LazyRow
+
+
+def __getattr__(name: str) -> object:
+    module_name = _EXPORTS.get(name)
+    if module_name is None:
+        raise AttributeError(f"module {__name__!r} has no attribute {name!r}")
+
+    from importlib import import_module
+    try:
+        value = getattr(import_module(f".{module_name}", __name__), name)
+    except ImportError:
+        if name != "LazyRow":
+            raise
+        # Without the C extension, lazy rows are just lists
+        value = list
+    globals()[name] = value
+    return value
+
+
+def __dir__() -> "List[str]":
+    return sorted(set(globals()) | set(_EXPORTS))
+
+
+if sys.version_info < (3, 7):
+    # Module __getattr__ (PEP 562) is only used since Python 3.7,
+    # so on older versions all the names are imported right away
+    for _name in _EXPORTS:
+        __getattr__(_name)
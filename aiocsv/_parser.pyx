@@ -1,7 +1,83 @@
+import collections.abc
 import csv
 
+from cpython.list cimport PyList_GET_SIZE
+from libc.stdint cimport int64_t
+
+cdef extern from "Python.h":
+    Py_UCS4 PyUnicode_READ(int kind, const void* data, Py_ssize_t index) nogil
+    int PyUnicode_KIND(object)
+    void* PyUnicode_DATA(object)
+    Py_ssize_t PyUnicode_GET_LENGTH(object)
+    object PyUnicode_Substring(object, Py_ssize_t, Py_ssize_t)
+    object PyUnicode_DecodeUTF8(const char*, Py_ssize_t, const char*)
+    object PyUnicode_FromKindAndData(int, const void*, Py_ssize_t)
+    bint PyUnicode_IS_ASCII(object)
+
+cdef extern from "_scan.h":
+    size_t aiocsv_find_any4(const unsigned char* p, size_t i, size_t n, unsigned char a,
+                            unsigned char b, unsigned char c, unsigned char d) nogil
+    size_t aiocsv_count_byte(const unsigned char* p, size_t i, size_t n, unsigned char c) nogil
+    size_t aiocsv_find_newline_outside_quotes(const unsigned char* p, size_t i, size_t n,
+                                              unsigned char quote, int* odd) nogil
+    int AIOCSV_SCAN_VARIANTS
+    bint aiocsv_scan_supported(int i)
+    const char* aiocsv_scan_variant_name(int i)
+    const char* aiocsv_scan_name()
+    int aiocsv_scan_select(const char* name)
+
+cdef extern from "_clock.h":
+    int64_t aiocsv_clock_ns() nogil
+
+
+def simd_variants():
+    """Returns names of the block scanning variants (see _scan.h) supported by this CPU,
+    from the slowest to the fastest."""
+    return [aiocsv_scan_variant_name(i).decode("ascii") for i in range(AIOCSV_SCAN_VARIANTS)
+            if aiocsv_scan_supported(i)]
+
+
+def simd_variant():
+    """Returns the name of the block scanning variant in use."""
+    return aiocsv_scan_name().decode("ascii")
+
+
+def select_simd_variant(name=None):
+    """Switches block scanning to the named variant, or to the fastest one supported by
+    this CPU if name is None. Meant for benchmarks and tests - readers which are
+    already running may use either variant."""
+    if name is None:
+        aiocsv_scan_select(NULL)
+        return
+
+    result = aiocsv_scan_select(name.encode("ascii"))
+    if result == -1:
+        names = [aiocsv_scan_variant_name(i).decode("ascii")
+                 for i in range(AIOCSV_SCAN_VARIANTS)]
+        raise ValueError(f"unknown SIMD variant {name!r}, expected one of {names}")
+    elif result == -2:
+        raise ValueError(f"SIMD variant {name!r} isn't supported by this CPU")
+
+
+def _select_simd_variant_from_env():
+    import os
+    import warnings
+    try:
+        select_simd_variant(os.environ.get("AIOCSV_SIMD") or None)
+    except ValueError as e:
+        # Importing aiocsv shouldn't fail because of a setting meant for benchmarks
+        warnings.warn(f"ignoring AIOCSV_SIMD: {e}", RuntimeWarning)
+        select_simd_variant()
+
+
+_select_simd_variant_from_env()
+
+
 DEF READ_SIZE = 2048
 
+# Value of unset special characters, which can't appear in any str
+DEF NOT_SET = 0x110000
+
 
 cdef enum ParserState:
     AFTER_ROW
@@ -20,6 +96,16 @@ cdef enum ReadQuoting:
     OTHER
 
 
+cdef enum ReadNewline:
+    # Any sequence of '\r' and '\n' ends a row
+    ANY
+    # Only '\n' ends a row, and every '\n' ends a row ('\r' is a normal character)
+    LF
+    # Only '\r\n' ends a row, and every '\r\n' ends a row
+    # ('\r' and '\n' on their own are normal characters)
+    CRLF
+
+
 cdef struct CDialect:
     bint skipinitialspace
     bint doublequote
@@ -28,10 +114,14 @@ cdef struct CDialect:
     Py_UCS4 delimiter
     Py_UCS4 quotechar
     Py_UCS4 escapechar
+    ReadNewline newline
+    bint skip_blank_lines
 
 
 cdef CDialect get_dialect(object pydialect):
     cdef CDialect d
+    d.newline = ReadNewline.ANY
+    d.skip_blank_lines = False
 
     # Bools
     d.skipinitialspace = <bint?>pydialect.skipinitialspace
@@ -49,31 +139,342 @@ cdef CDialect get_dialect(object pydialect):
     # Chars
     d.delimiter = <Py_UCS4?>pydialect.delimiter[0]
     d.quotechar = <Py_UCS4?>pydialect.quotechar[0] \
-        if pydialect.quotechar is not None else u'\0'
+        if pydialect.quotechar is not None else NOT_SET
     d.escapechar = <Py_UCS4?>pydialect.escapechar[0] \
-        if pydialect.escapechar is not None else u'\0'
+        if pydialect.escapechar is not None else NOT_SET
 
     return d
 
 
-async def parser(reader, pydialect):
+cdef set_newline(CDialect* d, object newline, bint skip_blank_lines):
+    if newline is None:
+        d.newline = ReadNewline.ANY
+    elif newline == "\n":
+        d.newline = ReadNewline.LF
+    elif newline == "\r\n":
+        d.newline = ReadNewline.CRLF
+    else:
+        raise ValueError(f"invalid newline: {newline!r}")
+    d.skip_blank_lines = skip_blank_lines
+
+
+cdef inline bint is_eol(const CDialect* d, Py_UCS4 char, bint cr_before) noexcept nogil:
+    if d.newline == ReadNewline.ANY:
+        return char == u'\r' or char == u'\n'
+    elif d.newline == ReadNewline.LF:
+        return char == u'\n'
+    return char == u'\n' and cr_before
+
+
+cdef enum CellStep:
+    # The char is a part of the cell's value
+    CELL_VALUE
+    # The char is a quotechar or an escapechar, which isn't a part of the value
+    CELL_SPECIAL
+    # The char ends the cell (or the row) - the state is left unchanged
+    CELL_END
+    # The char follows a quotechar closing a quoted part of the cell. It's a part of the value,
+    # but strict dialects don't allow it.
+    CELL_STRAY
+
+
+cdef inline CellStep cell_step(const CDialect* d, ParserState* state, Py_UCS4 char,
+                               bint boundary) noexcept nogil:
+    """Moves *state (AFTER_DELIM or a cell state) past char. This is the part of the state
+    machine dealing with quotes and escapes, shared by `parser`, BufferIndex.run
+    and unescape_into. `boundary` tells if char is a delimiter or a line break,
+    which ends the cell outside of quotes. Whitespace after a delimiter is left to the caller."""
+    if state[0] == ParserState.AFTER_DELIM:
+        if boundary:
+            return CellStep.CELL_END
+        elif char == d.quotechar and d.quoting != ReadQuoting.NONE:
+            state[0] = ParserState.IN_CELL_QUOTED
+            return CellStep.CELL_SPECIAL
+        elif char == d.escapechar:
+            state[0] = ParserState.ESCAPE
+            return CellStep.CELL_SPECIAL
+        state[0] = ParserState.IN_CELL
+        return CellStep.CELL_VALUE
+
+    elif state[0] == ParserState.IN_CELL:
+        if boundary:
+            return CellStep.CELL_END
+        elif char == d.escapechar:
+            state[0] = ParserState.ESCAPE
+            return CellStep.CELL_SPECIAL
+        return CellStep.CELL_VALUE
+
+    elif state[0] == ParserState.ESCAPE:
+        state[0] = ParserState.IN_CELL
+        return CellStep.CELL_VALUE
+
+    elif state[0] == ParserState.IN_CELL_QUOTED:
+        if char == d.escapechar:
+            state[0] = ParserState.ESCAPE_QUOTED
+            return CellStep.CELL_SPECIAL
+        elif d.quoting != ReadQuoting.NONE and char == d.quotechar:
+            # A double-quote, or the end of the quoted part of the cell
+            state[0] = ParserState.QUOTE_IN_QUOTED if d.doublequote else ParserState.IN_CELL
+            return CellStep.CELL_SPECIAL
+        return CellStep.CELL_VALUE
+
+    elif state[0] == ParserState.ESCAPE_QUOTED:
+        state[0] = ParserState.IN_CELL_QUOTED
+        return CellStep.CELL_VALUE
+
+    # QUOTE_IN_QUOTED, which can only be entered with doublequote on
+    if char == d.quotechar:
+        state[0] = ParserState.IN_CELL_QUOTED
+        return CellStep.CELL_VALUE
+    elif boundary:
+        return CellStep.CELL_END
+    state[0] = ParserState.IN_CELL
+    return CellStep.CELL_STRAY
+
+
+cdef inline Py_ssize_t add_cell(list row, Py_ssize_t col, object value) except -1:
+    """Sets row[col] to value, extending the row if necessary. Returns the next column."""
+    if col < PyList_GET_SIZE(row):
+        row[col] = value
+    else:
+        row.append(value)
+    return col + 1
+
+
+cdef inline list finish_row(list row, Py_ssize_t col):
+    """Removes any cells left over from a reused or pre-sized row."""
+    if col < PyList_GET_SIZE(row):
+        del row[col:]
+    return row
+
+
+cdef inline unsigned char byte_or(Py_UCS4 char, unsigned char fallback) noexcept nogil:
+    return <unsigned char>char if char < 256 else fallback
+
+
+cdef inline Py_ssize_t find_special(int kind, const void* data, Py_ssize_t i, Py_ssize_t n,
+                                    Py_UCS4 a, Py_UCS4 b, Py_UCS4 c, Py_UCS4 d) noexcept nogil:
+    """Returns the position of the first a, b, c or d in data[i:n], or n."""
+    cdef Py_UCS4 char
+    cdef unsigned char any_byte
+
+    if kind == 1:
+        # Compared in blocks (see _scan.h). Characters which can't be in the data (NOT_SET,
+        # or outside of latin-1) are replaced by one of the others.
+        if a < 256 or b < 256 or c < 256 or d < 256:
+            any_byte = byte_or(a, byte_or(b, byte_or(c, <unsigned char>d)))
+            return aiocsv_find_any4(<const unsigned char*>data, i, n, any_byte,
+                                    byte_or(b, any_byte), byte_or(c, any_byte),
+                                    byte_or(d, any_byte))
+        return n
+
+    while i < n:
+        char = PyUnicode_READ(kind, data, i)
+        if char == a or char == b or char == c or char == d:
+            break
+        i += 1
+    return i
+
+
+cdef class Progress:
+    """Calls on_progress(chars_read, rows) every `every` characters, and at the end of the file.
+    The callback may be a coroutine function."""
+    cdef object on_progress
+    cdef Py_ssize_t every
+    cdef Py_ssize_t next_report
+    cdef public Py_ssize_t chars
+    cdef public Py_ssize_t rows
+
+    def __cinit__(self, on_progress, Py_ssize_t every):
+        self.on_progress = on_progress
+        self.every = max(every, 1)
+        self.next_report = self.every
+        self.chars = 0
+        self.rows = 0
+
+    cdef inline bint due(self, Py_ssize_t chars):
+        """Records that `chars` more characters were read,
+        and returns True if the callback should be called."""
+        self.chars += chars
+        return self.chars >= self.next_report
+
+    async def report(self):
+        self.next_report = self.chars + self.every
+        result = self.on_progress(self.chars, self.rows)
+        # Not inspect.isawaitable, as importing inspect takes longer than the whole module
+        if isinstance(result, collections.abc.Awaitable):
+            await result
+
+
+# Profile buckets other than the parser states
+DEF PROFILE_READ = 8
+DEF PROFILE_CONSUMER = 9
+DEF PROFILE_FLOAT = 10
+DEF PROFILE_BUCKETS = 11
+
+PROFILE_NAMES = (
+    "AFTER_ROW", "AFTER_DELIM", "IN_CELL", "ESCAPE", "IN_CELL_QUOTED", "ESCAPE_QUOTED",
+    "QUOTE_IN_QUOTED", "EAT_NEWLINE", "read", "consumer", "float",
+)
+
+
+cdef class Profile:
+    """Attributes characters and time spent by the parser to its states,
+    reads from the file, the consumer of rows and float conversions. See report()."""
+    cdef Py_ssize_t chars[PROFILE_BUCKETS]
+    cdef Py_ssize_t count[PROFILE_BUCKETS]
+    cdef int64_t ticks[PROFILE_BUCKETS]
+    cdef ParserState current
+    cdef int64_t since
+
+    def __cinit__(self):
+        cdef int i
+        for i in range(PROFILE_BUCKETS):
+            self.chars[i] = 0
+            self.count[i] = 0
+            self.ticks[i] = 0
+        self.current = ParserState.AFTER_DELIM
+        self.since = aiocsv_clock_ns()
+
+    cdef inline void charge(self, int bucket) noexcept:
+        """Adds the time since the last charge to the bucket."""
+        cdef int64_t now = aiocsv_clock_ns()
+        self.ticks[bucket] += now - self.since
+        self.since = now
+
+    cdef inline void enter(self, ParserState state) noexcept:
+        if state != self.current:
+            self.charge(self.current)
+            self.current = state
+            self.count[<int>state] += 1
+
+    cdef inline void step(self, ParserState state) noexcept:
+        """Records that a single char is processed in the given state."""
+        self.chars[<int>state] += 1
+        self.enter(state)
+
+    cdef inline void scanned(self, ParserState state, Py_ssize_t chars) noexcept:
+        """Records that `chars` more chars were skipped over by a scan in the given state."""
+        self.chars[<int>state] += chars
+
+    cdef inline void read(self, Py_ssize_t chars) noexcept:
+        """Called right after a read of `chars` characters."""
+        self.charge(PROFILE_READ)
+        self.count[PROFILE_READ] += 1
+        self.chars[PROFILE_READ] += chars
+
+    cdef inline void resumed(self) noexcept:
+        """Called right after the consumer asks for the next row."""
+        self.charge(PROFILE_CONSUMER)
+        self.count[PROFILE_CONSUMER] += 1
+
+    cdef object to_float(self, unicode cell):
+        self.charge(self.current)
+        value = float(cell)
+        self.charge(PROFILE_FLOAT)
+        self.count[PROFILE_FLOAT] += 1
+        self.chars[PROFILE_FLOAT] += len(cell)
+        return value
+
+    def report(self):
+        """Returns a dict mapping bucket names to dicts with "chars", "count" and "seconds".
+
+        Buckets named after parser states count the chars processed in that state,
+        and how many times the parser entered it. "read" counts reads from the file,
+        "consumer" counts rows (with the time spent outside the parser), and "float"
+        counts QUOTE_NONNUMERIC conversions."""
+        return {
+            name: {
+                "chars": self.chars[i],
+                "count": self.count[i],
+                "seconds": self.ticks[i] / 1e9,
+            }
+            for i, name in enumerate(PROFILE_NAMES)
+        }
+
+
+cdef inline object convert_cell(unicode cell, bint numeric, Profile profile):
+    if not numeric:
+        return cell
+    elif profile is None:
+        return float(cell)
+    return profile.to_float(cell)
+
+
+async def parser(reader, pydialect, newline=None, bint skip_blank_lines=False,
+                 Progress progress=None, Profile profile=None):
+    if profile is not None:
+        profile.since = aiocsv_clock_ns()
     cdef unicode data = <unicode?>(await reader.read(READ_SIZE))
     cdef CDialect dialect = get_dialect(pydialect)
+    set_newline(&dialect, newline, skip_blank_lines)
 
     cdef ParserState state = ParserState.AFTER_DELIM
+    # Row ends after which the parser doesn't need to eat more line breaks
+    cdef ParserState after_eol = ParserState.EAT_NEWLINE \
+        if dialect.newline == ReadNewline.ANY else ParserState.AFTER_ROW
+    # Chars ending the fast scan of an unquoted cell, and of a quoted cell
+    cdef Py_UCS4 cell_stop = u'\n' if dialect.newline == ReadNewline.LF else u'\r'
+    cdef Py_UCS4 quoted_stop = dialect.quotechar \
+        if dialect.quoting != ReadQuoting.NONE else dialect.escapechar
 
+    # Rows are pre-sized to the width of the previous row. A list to fill with the next
+    # row can also be sent to the generator (see AsyncReader.readbatch).
     cdef list row = []
+    cdef Py_ssize_t col = 0
+    cdef object target
     cdef unicode cell = u""
     cdef bint force_save_cell = False
     cdef bint numeric_cell = False
+    # (ReadNewline.CRLF only) A '\r' was seen, which might start a line terminator
+    cdef bint pending_cr = False
+    # The unquoted cell contains an escaped line break, after which csv.reader
+    # doesn't expect the data to end
+    cdef bint escaped_eol = False
+    cdef bint cr_before
     cdef Py_UCS4 char
+    cdef ParserState prev
+    cdef CellStep step
+
+    cdef Py_ssize_t i, j, length
+    cdef int kind
+    cdef const void* ptr
+
+    if profile is not None:
+        profile.read(len(data))
+    if progress is not None and progress.due(len(data)):
+        await progress.report()
 
     # Iterate while the reader gives out data
     while data:
+        length = PyUnicode_GET_LENGTH(data)
+        kind = PyUnicode_KIND(data)
+        ptr = PyUnicode_DATA(data)
+        i = 0
 
         # Iterate charachter-by-charachter over the input file
         # and update the parser state
-        for char in data:
+        while i < length:
+            char = PyUnicode_READ(kind, ptr, i)
+            i += 1
+            if profile is not None:
+                profile.step(state)
+
+            # '\r' without a following '\n' is a normal char in the CRLF mode
+            cr_before = pending_cr
+            if pending_cr:
+                pending_cr = False
+                if char != u'\n':
+                    prev = state
+                    step = cell_step(&dialect, &state, u'\r', False)
+                    if step == CellStep.CELL_STRAY and dialect.strict:
+                        raise csv.Error(
+                            f"'{dialect.delimiter}' expected after '{dialect.quotechar}'"
+                        )
+                    if step != CellStep.CELL_SPECIAL:
+                        cell += u'\r'
+                    if prev == ParserState.AFTER_DELIM and state == ParserState.IN_CELL:
+                        numeric_cell = dialect.quoting == ReadQuoting.NONNUMERIC
 
             # Switch case depedning on the state
 
@@ -84,139 +485,2224 @@ async def parser(reader, pydialect):
             # (fallthrough)
 
             if state == ParserState.AFTER_ROW:
-                yield row
-                row = []
+                if col > 0 or not dialect.skip_blank_lines:
+                    if progress is not None:
+                        progress.rows += 1
+                    if profile is not None:
+                        profile.charge(profile.current)
+                    target = yield finish_row(row, col)
+                    if profile is not None:
+                        profile.resumed()
+                    row = <list?>target if target is not None else [None] * col
+                    col = 0
                 state = ParserState.AFTER_DELIM
 
             # (fallthrough)
-            if state == ParserState.AFTER_DELIM:
-                # -- After the end of a field or a row --
-
-                # 1. We were asked to skip whitespace right after the delimiter
-                if dialect.skipinitialspace and char == u' ':
-                    force_save_cell = True
-
-                # 2. Empty field + End of row
-                elif char == u'\r' or char == u'\n':
-                    if len(row) > 0 or force_save_cell:
-                        row.append(cell)
-                    state = ParserState.EAT_NEWLINE
-
-                # 3. Empty field
-                elif char == dialect.delimiter:
-                    row.append(cell)
-                    cell = u""
-                    force_save_cell = False
-                    # state stays unchanged (AFTER_DELIM)
-
-                # 4. Start of a quoted cell
-                elif char == dialect.quotechar and dialect.quoting != ReadQuoting.NONE:
-                    state = ParserState.IN_CELL_QUOTED
-
-                # 5. Start of an escape in an unqoted field
-                elif char == dialect.escapechar:
-                    state = ParserState.ESCAPE
-
-                # 6. Start of an unquoted field
+            # We were asked to skip whitespace right after the delimiter
+            if state == ParserState.AFTER_DELIM and dialect.skipinitialspace and char == u' ':
+                force_save_cell = True
+                continue
+
+            if state == ParserState.ESCAPE:
+                escaped_eol = char == u'\r' or char == u'\n'
+
+            # Quotes and escapes
+            prev = state
+            step = cell_step(&dialect, &state, char,
+                             char == dialect.delimiter or is_eol(&dialect, char, cr_before)
+                             or (char == u'\r' and dialect.newline == ReadNewline.CRLF))
+
+            if step == CellStep.CELL_END:
+                # 1. End of a row
+                if is_eol(&dialect, char, cr_before):
+                    # (an empty field is only saved if the row has other fields)
+                    if state != ParserState.AFTER_DELIM or col > 0 or force_save_cell:
+                        col = add_cell(row, col, convert_cell(cell, numeric_cell, profile))
+                    state = after_eol
+
+                # 2. Possible end of a row
+                elif char == u'\r' and dialect.newline == ReadNewline.CRLF:
+                    pending_cr = True
+                    continue
+
+                # 3. End of a cell
                 else:
-                    cell += char
-                    state = ParserState.IN_CELL
+                    col = add_cell(row, col, convert_cell(cell, numeric_cell, profile))
+                    state = ParserState.AFTER_DELIM
+
+                cell = u""
+                force_save_cell = False
+                numeric_cell = False
+                escaped_eol = False
+
+            elif step != CellStep.CELL_SPECIAL:
+                if step == CellStep.CELL_STRAY and dialect.strict:
+                    raise csv.Error(
+                        f"'{dialect.delimiter}' expected after '{dialect.quotechar}'"
+                    )
+
+                # Start of an unquoted cell
+                if prev == ParserState.AFTER_DELIM:
                     numeric_cell = dialect.quoting == ReadQuoting.NONNUMERIC
+                    if profile is not None:
+                        profile.enter(ParserState.IN_CELL)
 
-            elif state == ParserState.IN_CELL:
-                # -- Inside an unqouted cell --
+                # Take the char, and all the following ones which can't change the state
+                if state == ParserState.IN_CELL:
+                    j = find_special(kind, ptr, i, length, dialect.delimiter, dialect.escapechar,
+                                     u'\n', cell_stop)
+                else:
+                    j = find_special(kind, ptr, i, length, dialect.escapechar, quoted_stop,
+                                     dialect.escapechar, quoted_stop)
+                if profile is not None:
+                    profile.scanned(state, j - i)
+                cell += data[i - 1:j]
+                i = j
 
-                # 1. End of a row
+        # Read more data
+        if profile is not None:
+            profile.charge(profile.current)
+        data = <unicode?>(await reader.read(READ_SIZE))
+        if profile is not None:
+            profile.read(len(data))
+        if progress is not None and progress.due(len(data)):
+            await progress.report()
+
+    # End of the file - save the last cell, like csv.reader.
+    # (A '\r' right before the end of the file is treated as a line terminator)
+    if state == ParserState.AFTER_DELIM:
+        if col > 0 or force_save_cell:
+            col = add_cell(row, col, cell)
+
+    elif state == ParserState.IN_CELL or state == ParserState.ESCAPE:
+        if dialect.strict and (escaped_eol or state == ParserState.ESCAPE):
+            raise csv.Error("unexpected end of data")
+        if state == ParserState.ESCAPE:
+            cell += u'\n'
+        col = add_cell(row, col, convert_cell(cell, numeric_cell, profile))
+
+    elif state == ParserState.IN_CELL_QUOTED or state == ParserState.ESCAPE_QUOTED:
+        if dialect.strict:
+            raise csv.Error("unexpected end of data")
+        if state == ParserState.ESCAPE_QUOTED:
+            cell += u'\n'
+        col = add_cell(row, col, cell)
+
+    elif state == ParserState.QUOTE_IN_QUOTED:
+        col = add_cell(row, col, cell)
+
+    # (With ReadNewline.ANY, an empty row can only be pending after a blank line
+    # at the start of data)
+    if col > 0 or ((state == ParserState.AFTER_ROW or state == ParserState.EAT_NEWLINE)
+                   and not dialect.skip_blank_lines):
+        if progress is not None:
+            progress.rows += 1
+        if profile is not None:
+            profile.charge(profile.current)
+        yield finish_row(row, col)
+        if profile is not None:
+            profile.resumed()
+
+    if profile is not None:
+        profile.charge(profile.current)
+    if progress is not None:
+        await progress.report()
+
+
+# Structural index of in-memory buffers
+# =====================================
+#
+# Instead of building every cell character-by-character, BufferIndex runs the same
+# state machine as `parser` over a whole buffer without the GIL, only recording
+# where every field starts and ends. Python objects are created afterwards,
+# in `materialize`. As the indexer is resumable, a buffer can be split into segments
+# indexed on multiple threads, and then stitched back together.
+
+from cpython.buffer cimport PyObject_GetBuffer, PyBuffer_Release, PyBUF_SIMPLE
+from libc.stdlib cimport malloc, realloc, free
+
+from ._serializer cimport Field, Serializer
+
+DEF MIN_INDEX_CAPACITY = 64
+
+
+cdef enum FieldFlags:
+    # The field contains escapes or quotes, and has to be unescaped with unescape_field.
+    # Start and end point to the raw field.
+    FIELD_COMPLEX = 1
+    # The field has to be converted to a float
+    FIELD_NUMERIC = 2
+
+
+cdef struct FieldSpan:
+    Py_ssize_t start
+    Py_ssize_t end
+    int flags
+
+
+cdef struct FieldValue:
+    # Actual value of a field, in the source or in a scratch buffer
+    const void* data
+    int kind
+    Py_ssize_t length
+
+
+cdef struct Scratch:
+    Py_UCS4* data
+    Py_ssize_t capacity
+
+
+cdef int scratch_reserve(Scratch* scratch, Py_ssize_t capacity) except -1:
+    cdef Py_UCS4* data
+    if capacity > scratch.capacity:
+        capacity = max(capacity, 2 * scratch.capacity)
+        data = <Py_UCS4*>realloc(scratch.data, capacity * sizeof(Py_UCS4))
+        if data == NULL:
+            raise MemoryError()
+        scratch.data = data
+        scratch.capacity = capacity
+    return 0
+
+
+cdef enum IndexErrorKind:
+    NO_ERROR
+    # strict dialect: unexpected char after a quotechar closing a quoted field
+    QUOTE_EXPECTED
+    # strict dialect: data ends inside of a quoted field
+    UNEXPECTED_END
+
+
+cdef struct IndexState:
+    ParserState state
+    bint force_save_cell
+    bint numeric_cell
+    bint complex_cell
+    # See `escaped_eol` in `parser`
+    bint escaped_eol
+    Py_ssize_t cell_start
+    # Index of the first field of the current row
+    Py_ssize_t row_start
+    # Position in the source, where the current row starts,
+    # and the force_save_cell flag at that moment
+    Py_ssize_t row_start_pos
+    bint row_start_force_save
+    IndexErrorKind error
+
+
+cdef class Source:
+    """A str or a bytes-like object to be indexed.
+
+    UTF-8 bytes are indexed directly, as long as all of the dialect's special characters
+    are in ASCII; anything else is decoded into a str first.
+    """
+    cdef readonly object obj
+    cdef Py_buffer view
+    cdef bint has_view
+    cdef const void* data
+    cdef int kind
+    cdef readonly bint utf8
+    cdef readonly Py_ssize_t length
+    # memoryview over obj, created on demand by `bytes_view`
+    cdef object memview
+
+    def __cinit__(self, obj, str encoding, pydialect):
+        cdef CDialect d = get_dialect(pydialect)
+        self.has_view = False
+        self.memview = None
+
+        if not isinstance(obj, unicode) \
+                and encoding.lower().replace("_", "-") in ("utf-8", "utf8") \
+                and d.delimiter < 128 and (d.quotechar < 128 or d.quotechar == NOT_SET) \
+                and (d.escapechar < 128 or d.escapechar == NOT_SET):
+            PyObject_GetBuffer(obj, &self.view, PyBUF_SIMPLE)
+            self.has_view = True
+            self.obj = obj
+            self.data = self.view.buf
+            self.kind = 1
+            self.utf8 = True
+            self.length = self.view.len
+
+        else:
+            if not isinstance(obj, unicode):
+                obj = str(obj, encoding)
+            self.obj = obj
+            self.data = PyUnicode_DATA(obj)
+            self.kind = PyUnicode_KIND(obj)
+            self.utf8 = False
+            self.length = PyUnicode_GET_LENGTH(obj)
+
+    def __dealloc__(self):
+        self.release()
+
+    def release(self):
+        """Releases the underlying buffer. The source becomes empty."""
+        if self.has_view:
+            PyBuffer_Release(&self.view)
+            self.has_view = False
+        if self.memview is not None:
+            self.memview.release()
+            self.memview = None
+        self.obj = None
+        self.data = NULL
+        self.length = 0
+
+    cdef inline Py_UCS4 read(self, Py_ssize_t i) noexcept nogil:
+        return PyUnicode_READ(self.kind, self.data, i)
+
+    cdef object bytes_view(self, Py_ssize_t start, Py_ssize_t end):
+        """Returns a memoryview of UTF-8 bytes in self[start:end].
+        Only available if the source is indexed as UTF-8."""
+        if self.memview is None:
+            self.memview = memoryview(self.obj).cast("B")
+        return self.memview[start:end]
+
+    cdef unicode slice(self, Py_ssize_t start, Py_ssize_t end):
+        if start >= end:
+            return u""
+        elif self.utf8:
+            return PyUnicode_DecodeUTF8(<const char*>self.data + start, end - start, NULL)
+        else:
+            return PyUnicode_Substring(self.obj, start, end)
+
+    def count_quotes(self, Py_ssize_t start, Py_ssize_t end, Py_UCS4 quotechar):
+        """Counts occurrences of quotechar in self[start:end]."""
+        cdef Py_ssize_t count = 0
+        cdef Py_ssize_t i
+        with nogil:
+            if self.kind == 1:
+                if quotechar < 256:
+                    count = aiocsv_count_byte(<const unsigned char*>self.data, start, end,
+                                              <unsigned char>quotechar)
+            else:
+                for i in range(start, end):
+                    if self.read(i) == quotechar:
+                        count += 1
+        return count
+
+    def find_row_start(self, Py_ssize_t start, Py_ssize_t end, quotechar, bint odd):
+        """Returns the first position after a run of line breaks outside of quotes,
+        which starts in self[start:end]. `odd` should be set if an odd number of quotechars precede
+        `start`; quotechar may be None. Returns -1 if no such position exists."""
+        cdef Py_ssize_t i = start
+        cdef Py_UCS4 quote = NOT_SET if quotechar is None else <Py_UCS4?>quotechar
+        cdef Py_UCS4 c
+        cdef bint after_newline = False
+        cdef int parity = odd
+
+        with nogil:
+            # Skip whole blocks without line breaks outside of quotes (see _scan.h)
+            if self.kind == 1 and quote >= 256:
+                i = aiocsv_find_newline_outside_quotes(<const unsigned char*>self.data, i, end,
+                                                       u'\n', &parity)
+            elif self.kind == 1:
+                i = aiocsv_find_newline_outside_quotes(<const unsigned char*>self.data, i, end,
+                                                       <unsigned char>quote, &parity)
+            odd = parity
+
+            # A run of line breaks may continue past `end`
+            while i < self.length and (i < end or after_newline):
+                c = self.read(i)
+                if c == u'\r' or c == u'\n':
+                    after_newline = after_newline or not odd
+                elif after_newline:
+                    break
+                elif c == quote:
+                    odd = not odd
+                i += 1
+
+        return i if after_newline and i < self.length else -1
+
+
+cdef Py_ssize_t unescape_into(const void* data, int kind, Py_ssize_t start, Py_ssize_t end,
+                              const CDialect* dialect, Py_UCS4* buffer) noexcept nogil:
+    """Runs cell_step over a raw field, data[start:end], writing its actual value into buffer
+    (of at least end - start + 1 characters). Returns the length of the value."""
+    cdef Py_ssize_t used = 0
+    cdef ParserState state = ParserState.AFTER_DELIM
+    cdef Py_ssize_t i
+    cdef Py_UCS4 char
+
+    for i in range(start, end):
+        char = PyUnicode_READ(kind, data, i)
+        if cell_step(dialect, &state, char, False) != CellStep.CELL_SPECIAL:
+            buffer[used] = char
+            used += 1
+
+    # An escapechar at the end of the data escapes a line break, like in csv.reader
+    if state == ParserState.ESCAPE or state == ParserState.ESCAPE_QUOTED:
+        buffer[used] = u'\n'
+        used += 1
+
+    return used
+
+
+cdef unicode unescape_field(unicode raw, CDialect* dialect):
+    """Returns the actual value of a raw field."""
+    cdef Py_ssize_t length = PyUnicode_GET_LENGTH(raw)
+    cdef Py_UCS4* buffer = <Py_UCS4*>malloc((length + 1) * sizeof(Py_UCS4))
+    cdef Py_ssize_t used
+
+    if buffer == NULL:
+        raise MemoryError()
+
+    try:
+        used = unescape_into(PyUnicode_DATA(raw), PyUnicode_KIND(raw), 0, length, dialect, buffer)
+        return PyUnicode_FromKindAndData(4, buffer, used)
+    finally:
+        free(buffer)
+
+
+cdef class BufferIndex:
+    """Positions of all fields and rows of (a segment of) a Source."""
+    cdef readonly Source source
+    cdef object pydialect
+    cdef CDialect dialect
+
+    cdef FieldSpan* fields
+    cdef Py_ssize_t fields_len
+    cdef Py_ssize_t fields_cap
+
+    # rows[i] is the index of the first field after the i-th row
+    cdef Py_ssize_t* rows
+    cdef Py_ssize_t rows_len
+    cdef Py_ssize_t rows_cap
+
+    cdef IndexState s
+    cdef bint out_of_memory
+    cdef bint finished
+
+    def __cinit__(self, Source source, pydialect):
+        self.source = source
+        self.pydialect = pydialect
+        self.dialect = get_dialect(pydialect)
+
+        self.fields = NULL
+        self.fields_len = 0
+        self.fields_cap = 0
+        self.rows = NULL
+        self.rows_len = 0
+        self.rows_cap = 0
+
+        self.s.state = ParserState.AFTER_DELIM
+        self.s.force_save_cell = False
+        self.s.numeric_cell = False
+        self.s.complex_cell = False
+        self.s.escaped_eol = False
+        self.s.cell_start = 0
+        self.s.row_start = 0
+        self.s.row_start_pos = 0
+        self.s.row_start_force_save = False
+        self.s.error = IndexErrorKind.NO_ERROR
+        self.out_of_memory = False
+        self.finished = False
+
+    def __dealloc__(self):
+        free(self.fields)
+        free(self.rows)
+
+    @property
+    def at_row_boundary(self):
+        """True if the indexed data ended right after a complete row."""
+        return self.s.state == ParserState.EAT_NEWLINE and not self.s.force_save_cell \
+            and not self.s.error
+
+    def __len__(self):
+        return self.rows_len
+
+    # Building the index
+
+    cdef bint push_field(self, Py_ssize_t start, Py_ssize_t end, int flags) noexcept nogil:
+        cdef FieldSpan* new_fields
+        cdef Py_ssize_t new_cap
+
+        if self.fields_len == self.fields_cap:
+            new_cap = max(MIN_INDEX_CAPACITY, 2 * self.fields_cap)
+            new_fields = <FieldSpan*>realloc(self.fields, new_cap * sizeof(FieldSpan))
+            if new_fields == NULL:
+                self.out_of_memory = True
+                return False
+            self.fields = new_fields
+            self.fields_cap = new_cap
+
+        self.fields[self.fields_len].start = start
+        self.fields[self.fields_len].end = end
+        self.fields[self.fields_len].flags = flags
+        self.fields_len += 1
+        return True
+
+    cdef bint push_row(self, Py_ssize_t pos) noexcept nogil:
+        cdef Py_ssize_t* new_rows
+        cdef Py_ssize_t new_cap
+
+        if self.rows_len == self.rows_cap:
+            new_cap = max(MIN_INDEX_CAPACITY, 2 * self.rows_cap)
+            new_rows = <Py_ssize_t*>realloc(self.rows, new_cap * sizeof(Py_ssize_t))
+            if new_rows == NULL:
+                self.out_of_memory = True
+                return False
+            self.rows = new_rows
+            self.rows_cap = new_cap
+
+        self.rows[self.rows_len] = self.fields_len
+        self.rows_len += 1
+        self.s.row_start = self.fields_len
+        self.s.row_start_pos = pos
+        self.s.row_start_force_save = self.s.force_save_cell
+        return True
+
+    cdef bint push_cell(self, Py_ssize_t end) noexcept nogil:
+        """Saves the current cell, which ends at `end`. Returns False on failure."""
+        cdef int flags = 0
+        cdef Py_ssize_t start = self.s.cell_start
+
+        if self.s.complex_cell:
+            flags |= FieldFlags.FIELD_COMPLEX
+
+        elif self.s.state == ParserState.IN_CELL_QUOTED:
+            # Unterminated quoted cell
+            start += 1
+
+        elif self.s.state == ParserState.QUOTE_IN_QUOTED:
+            start += 1
+            end -= 1
+
+        if self.s.numeric_cell:
+            flags |= FieldFlags.FIELD_NUMERIC
+
+        self.s.complex_cell = False
+        return self.push_field(start, end, flags)
+
+    cdef inline void start_cell(self, Py_ssize_t i) noexcept nogil:
+        self.s.cell_start = i
+        self.s.complex_cell = False
+
+    cdef void run(self, Py_ssize_t start, Py_ssize_t end) noexcept nogil:
+        """Indexes source[start:end], continuing from the current state.
+        Mirrors the `parser` coroutine."""
+        cdef IndexState* s = &self.s
+        cdef CDialect* dialect = &self.dialect
+        cdef int kind = self.source.kind
+        cdef const void* data = self.source.data
+        cdef Py_ssize_t i = start
+        cdef Py_UCS4 char
+        cdef Py_UCS4 quoted_stop = dialect.quotechar if dialect.quoting != ReadQuoting.NONE \
+            else NOT_SET
+        cdef ParserState prev
+        cdef CellStep step
+        cdef bint eol
+
+        if s.error or self.out_of_memory:
+            return
+
+        while i < end:
+            # Skip to the next character, which can change the state of a cell
+            if s.state == ParserState.IN_CELL:
+                i = find_special(kind, data, i, end, dialect.delimiter, dialect.escapechar,
+                                 u'\r', u'\n')
+            elif s.state == ParserState.IN_CELL_QUOTED:
+                i = find_special(kind, data, i, end, dialect.escapechar, quoted_stop,
+                                 dialect.escapechar, quoted_stop)
+            if i == end:
+                break
+
+            char = PyUnicode_READ(kind, data, i)
+
+            if s.state == ParserState.EAT_NEWLINE:
                 if char == u'\r' or char == u'\n':
-                    row.append(float(cell) if numeric_cell else cell)
+                    i += 1
+                    continue
+                s.state = ParserState.AFTER_ROW
+            # (fallthrough)
 
-                    cell = u""
-                    force_save_cell = False
-                    numeric_cell = False
-                    state = ParserState.EAT_NEWLINE
+            if s.state == ParserState.AFTER_ROW:
+                if not self.push_row(i):
+                    return
+                s.state = ParserState.AFTER_DELIM
 
-                # 2. End of a cell
-                elif char == dialect.delimiter:
-                    row.append(float(cell) if numeric_cell else cell)  # type: ignore
+            # (fallthrough)
+            # We were asked to skip whitespace right after the delimiter
+            if s.state == ParserState.AFTER_DELIM and dialect.skipinitialspace and char == u' ':
+                s.force_save_cell = True
+                i += 1
+                continue
 
-                    cell = u""
-                    force_save_cell = False
-                    numeric_cell = False
-                    state = ParserState.AFTER_DELIM
+            if s.state == ParserState.ESCAPE:
+                s.escaped_eol = char == u'\r' or char == u'\n'
+
+            # Quotes and escapes
+            prev = s.state
+            step = cell_step(dialect, &s.state, char,
+                             char == dialect.delimiter or char == u'\r' or char == u'\n')
+
+            if step == CellStep.CELL_END:
+                eol = char == u'\r' or char == u'\n'
+                if prev != ParserState.AFTER_DELIM:
+                    if not self.push_cell(i):
+                        return
+                # (an empty field at the end of a row is only saved if the row has other fields)
+                elif not eol or self.fields_len > s.row_start or s.force_save_cell:
+                    if not self.push_field(i, i, 0):
+                        return
+                s.force_save_cell = False
+                s.numeric_cell = False
+                s.escaped_eol = False
+                s.state = ParserState.EAT_NEWLINE if eol else ParserState.AFTER_DELIM
+
+            else:
+                if prev == ParserState.AFTER_DELIM:
+                    self.start_cell(i)
+                    if s.state == ParserState.IN_CELL:
+                        s.numeric_cell = dialect.quoting == ReadQuoting.NONNUMERIC
+
+                # Only the quotes around a cell can be stripped without unescaping it
+                if prev == ParserState.QUOTE_IN_QUOTED or (
+                        step == CellStep.CELL_SPECIAL and s.state != ParserState.IN_CELL_QUOTED
+                        and s.state != ParserState.QUOTE_IN_QUOTED):
+                    s.complex_cell = True
+
+                if step == CellStep.CELL_STRAY and dialect.strict:
+                    s.error = IndexErrorKind.QUOTE_EXPECTED
+                    return
+
+            i += 1
+
+    def index(self, Py_ssize_t start, Py_ssize_t end):
+        """Indexes source[start:end], continuing from the current state.
+        The GIL is released while indexing."""
+        if self.finished:
+            raise RuntimeError("index was already finished")
+        if start < 0 or end > self.source.length:
+            raise IndexError("indexed range outside of the source")
+        with nogil:
+            self.run(start, end)
+        if self.out_of_memory:
+            raise MemoryError()
+
+    def finish(self):
+        """Marks the end of the source, saving the last cell and row."""
+        if self.finished or self.s.error:
+            return
+        self.finished = True
+
+        # Save the last cell, like `parser`
+        if self.s.state == ParserState.AFTER_DELIM:
+            if self.fields_len > self.s.row_start or self.s.force_save_cell:
+                self.push_field(self.source.length, self.source.length, 0)
+
+        elif self.s.state == ParserState.IN_CELL_QUOTED \
+                or self.s.state == ParserState.ESCAPE_QUOTED \
+                or self.s.state == ParserState.ESCAPE:
+            if self.dialect.strict:
+                self.s.error = IndexErrorKind.UNEXPECTED_END
+                return
+            self.push_cell(self.source.length)
+
+        elif self.s.state == ParserState.IN_CELL:
+            if self.dialect.strict and self.s.escaped_eol:
+                self.s.error = IndexErrorKind.UNEXPECTED_END
+                return
+            self.push_cell(self.source.length)
+
+        elif self.s.state != ParserState.EAT_NEWLINE and self.s.state != ParserState.AFTER_ROW:
+            self.push_cell(self.source.length)
+
+        if self.fields_len > self.s.row_start or self.s.state == ParserState.EAT_NEWLINE:
+            self.push_row(self.source.length)
+
+        if self.out_of_memory:
+            raise MemoryError()
+
+    def absorb(self, BufferIndex other):
+        """Appends the index of the segment directly following this one.
+        This index has to end at a row boundary."""
+        cdef Py_ssize_t i
+        cdef Py_ssize_t offset
+
+        if not self.at_row_boundary:
+            raise ValueError("index doesn't end at a row boundary")
+
+        self.push_row(0)
+        offset = self.fields_len
+
+        for i in range(other.fields_len):
+            self.push_field(other.fields[i].start, other.fields[i].end, other.fields[i].flags)
+        for i in range(other.rows_len):
+            if self.push_row(0):
+                self.rows[self.rows_len - 1] = other.rows[i] + offset
+
+        self.s = other.s
+        self.s.row_start = other.s.row_start + offset
+
+        if self.out_of_memory:
+            raise MemoryError()
+
+    # Materializing the rows
+
+    cdef object field_value(self, FieldSpan* field):
+        cdef unicode value = self.source.slice(field.start, field.end)
+
+        if field.flags & FieldFlags.FIELD_COMPLEX:
+            value = unescape_field(value, &self.dialect)
+
+        if field.flags & FieldFlags.FIELD_NUMERIC:
+            return float(value)
+
+        return value
+
+    cpdef check_error(self):
+        """Raises csv.Error if invalid data was encountered while indexing."""
+        if self.s.error == IndexErrorKind.QUOTE_EXPECTED:
+            raise csv.Error(f"'{self.pydialect.delimiter}' expected after "
+                            f"'{self.pydialect.quotechar}'")
+        elif self.s.error == IndexErrorKind.UNEXPECTED_END:
+            raise csv.Error("unexpected end of data")
+
+    cdef inline Py_ssize_t row_number(self, Py_ssize_t n, object rows) except -1:
+        """Returns the n-th row number of `rows`, or n if rows is None."""
+        cdef Py_ssize_t r = n if rows is None else rows[n]
+        if r < 0 or r >= self.rows_len:
+            raise IndexError("row number out of range")
+        return r
+
+    def materialize(self, select=None, rows=None):
+        """Returns a list of all indexed rows. If `select` is given, rows only contain fields
+        at those (non-negative) indices, with missing fields replaced by empty strings;
+        empty rows stay empty. If `rows` is given, only rows with those numbers
+        are returned, in that order."""
+        cdef Py_ssize_t count = self.rows_len if rows is None else len(rows)
+        cdef list result = [None] * count
+        cdef list row
+        cdef Py_ssize_t n, r, f, i, column
+        cdef Py_ssize_t first
+        cdef Py_ssize_t select_len = 0 if select is None else len(select)
+
+        if self.source.obj is None:
+            raise ValueError("source was released")
+
+        for n in range(count):
+            r = self.row_number(n, rows)
+            first = self.rows[r - 1] if r > 0 else 0
+
+            if select is None:
+                row = [None] * (self.rows[r] - first)
+                for f in range(first, self.rows[r]):
+                    row[f - first] = self.field_value(&self.fields[f])
+
+            elif self.rows[r] == first:
+                row = []
+
+            else:
+                row = [u""] * select_len
+                for i in range(select_len):
+                    column = select[i]
+                    if column < 0:
+                        raise ValueError("selected field indices can't be negative")
+                    if first + column < self.rows[r]:
+                        row[i] = self.field_value(&self.fields[first + column])
+
+            result[n] = row
+
+        self.check_error()
+        return result
+
+    cdef object field_view(self, FieldSpan* field):
+        cdef unicode value
+
+        # Fields without any quotes or escapes are exactly a part of the source
+        if self.source.utf8 and not field.flags & FieldFlags.FIELD_COMPLEX:
+            return self.source.bytes_view(field.start, field.end)
+
+        value = self.source.slice(field.start, field.end)
+        if field.flags & FieldFlags.FIELD_COMPLEX:
+            value = unescape_field(value, &self.dialect)
+        return value.encode("utf-8")
+
+    def view_rows(self, rows=None):
+        """Returns a list of all indexed rows (or ones with numbers in `rows`),
+        as lists of bytes-like objects. Where possible, those are memoryviews of the source.
+        QUOTE_NONNUMERIC fields aren't converted to floats."""
+        cdef Py_ssize_t count = self.rows_len if rows is None else len(rows)
+        cdef list result = [None] * count
+        cdef list row
+        cdef Py_ssize_t n, r, f
+        cdef Py_ssize_t first
+
+        if self.source.obj is None:
+            raise ValueError("source was released")
+
+        for n in range(count):
+            r = self.row_number(n, rows)
+            first = self.rows[r - 1] if r > 0 else 0
+            row = [None] * (self.rows[r] - first)
+            for f in range(first, self.rows[r]):
+                row[f - first] = self.field_view(&self.fields[f])
+            result[n] = row
+
+        return result
+
+    def lazy_rows(self, rows=None):
+        """Returns a list of all indexed rows (or ones with numbers in `rows`)
+        as LazyRow objects."""
+        cdef Py_ssize_t count = self.rows_len if rows is None else len(rows)
+        cdef list result = [None] * count
+        cdef Py_ssize_t n, r
+
+        if self.source.obj is None:
+            raise ValueError("source was released")
+
+        for n in range(count):
+            r = self.row_number(n, rows)
+            result[n] = LazyRow.create(self, self.rows[r - 1] if r > 0 else 0, self.rows[r])
+
+        return result
+
+    cdef int transcribe_field(self, FieldSpan* field, Field* out, Serializer serializer,
+                              bint ascii, Py_UCS4** scratch, list strings) except -1:
+        """Prepares a field for the serializer, without creating any Python objects
+        (apart from QUOTE_NONNUMERIC numbers). Values of fields with quotes or escapes
+        are written to *scratch, which is advanced past them."""
+        if field.flags & FieldFlags.FIELD_NUMERIC:
+            serializer.prepare_field(self.field_value(field), out, strings)
+            return 0
+
+        out.quoted = serializer.quote_strings
+
+        if field.flags & FieldFlags.FIELD_COMPLEX:
+            out.data = scratch[0]
+            out.length = unescape_into(self.source.data, self.source.kind, field.start,
+                                       field.end, &self.dialect, scratch[0])
+            out.kind = 4
+            out.ascii = False
+            scratch[0] += out.length
+
+        else:
+            out.data = <const char*>self.source.data + field.start * self.source.kind
+            out.length = field.end - field.start
+            out.kind = self.source.kind
+            out.ascii = ascii
+
+        return 0
+
+    def transcribe(self, Serializer serializer, select=None, rows=None):
+        """Serializes all indexed rows with `serializer`, exactly like csv.writer would
+        write rows returned by `materialize`. If `select` is given, only the fields at
+        those indices are written; missing fields are written as empty strings,
+        but empty rows stay empty. If `rows` is given, only rows with those numbers
+        are written, in that order. Returns the number of written rows.
+
+        Fields are passed to the serializer straight from the source, or unescaped into
+        a scratch buffer - so memory use only depends on the longest row.
+        Only str sources are supported."""
+        cdef Py_ssize_t select_len = 0 if select is None else len(select)
+        cdef Py_ssize_t* columns = NULL
+        cdef FieldSpan** spans = NULL
+        cdef Field* fields = NULL
+        cdef Scratch scratch
+        cdef Py_UCS4* scratch_pos
+        cdef Py_ssize_t needed
+        cdef Py_ssize_t width = select_len
+        cdef Py_ssize_t r, i, count, n
+        cdef Py_ssize_t first = 0
+        cdef bint ascii
+        cdef list strings = []
+        cdef Py_ssize_t written = self.rows_len if rows is None else len(rows)
+
+        if self.source.obj is None:
+            raise ValueError("source was released")
+        if self.source.utf8:
+            raise ValueError("only str sources can be transcribed")
+        ascii = PyUnicode_IS_ASCII(self.source.obj)
+        scratch.data = NULL
+        scratch.capacity = 0
+
+        if select is None:
+            for r in range(self.rows_len):
+                width = max(width, self.rows[r] - first)
+                first = self.rows[r]
+            first = 0
 
-                # 3. Start of an espace
-                elif char == dialect.escapechar:
-                    state = ParserState.ESCAPE
+        columns = <Py_ssize_t*>malloc(max(select_len, 1) * sizeof(Py_ssize_t))
+        spans = <FieldSpan**>malloc(max(width, 1) * sizeof(FieldSpan*))
+        fields = <Field*>malloc(max(width, 1) * sizeof(Field))
 
-                # 4. Normal char
+        try:
+            if columns == NULL or spans == NULL or fields == NULL:
+                raise MemoryError()
+
+            for i in range(select_len):
+                columns[i] = select[i]
+                if columns[i] < 0:
+                    raise ValueError("selected field indices can't be negative")
+
+            for n in range(written):
+                r = self.row_number(n, rows)
+                first = self.rows[r - 1] if r > 0 else 0
+
+                # 1. Pick the written fields (NULL for missing ones)
+                count = self.rows[r] - first
+                if select is None:
+                    for i in range(count):
+                        spans[i] = &self.fields[first + i]
+                elif count:
+                    for i in range(select_len):
+                        spans[i] = &self.fields[first + columns[i]] if columns[i] < count \
+                            else NULL
+                    count = select_len
+
+                # 2. Make sure all unescaped values fit in the scratch buffer
+                needed = 0
+                for i in range(count):
+                    if spans[i] != NULL and spans[i].flags & FieldFlags.FIELD_COMPLEX:
+                        needed += spans[i].end - spans[i].start + 1
+                scratch_reserve(&scratch, needed)
+
+                # 3. Serialize the row
+                scratch_pos = scratch.data
+                for i in range(count):
+                    if spans[i] == NULL:
+                        serializer.prepare_field(u"", &fields[i], strings)
+                    else:
+                        self.transcribe_field(spans[i], &fields[i], serializer, ascii,
+                                              &scratch_pos, strings)
+
+                serializer.write_fields(fields, count, strings)
+                if strings:
+                    del strings[:]
+
+        finally:
+            free(columns)
+            free(spans)
+            free(fields)
+            free(scratch.data)
+
+        return written
+
+    cdef int field_values(self, Py_ssize_t first, Py_ssize_t end, const Py_ssize_t* columns,
+                          Py_ssize_t n, FieldValue* out, Scratch* scratch) except -1:
+        """Points out[i] at the actual value of field columns[i] of the row fields[first:end]
+        (an empty value if the row has no such field). Values of fields with quotes or escapes
+        are unescaped into scratch, overwriting its previous contents.
+        QUOTE_NONNUMERIC fields are left as text."""
+        cdef Py_ssize_t i
+        cdef Py_ssize_t needed = 0
+        cdef Py_UCS4* scratch_pos
+        cdef FieldSpan* field
+
+        for i in range(n):
+            if first + columns[i] < end and \
+                    self.fields[first + columns[i]].flags & FieldFlags.FIELD_COMPLEX:
+                field = &self.fields[first + columns[i]]
+                needed += field.end - field.start + 1
+        scratch_reserve(scratch, needed)
+        scratch_pos = scratch.data
+
+        for i in range(n):
+            if first + columns[i] >= end:
+                out[i].data = NULL
+                out[i].kind = 1
+                out[i].length = 0
+                continue
+
+            field = &self.fields[first + columns[i]]
+            if field.flags & FieldFlags.FIELD_COMPLEX:
+                out[i].data = scratch_pos
+                out[i].kind = 4
+                out[i].length = unescape_into(self.source.data, self.source.kind, field.start,
+                                              field.end, &self.dialect, scratch_pos)
+                scratch_pos += out[i].length
+            else:
+                out[i].data = <const char*>self.source.data + field.start * self.source.kind
+                out[i].kind = self.source.kind
+                out[i].length = field.end - field.start
+
+        return 0
+
+
+cdef class LazyRow:
+    """A parsed CSV row, which creates values of fields only when they're accessed.
+    Behaves like a read-only list; use tolist() to get an actual list.
+
+    Keeps the whole indexed chunk alive.
+    """
+    cdef BufferIndex index
+    cdef Py_ssize_t first
+    cdef Py_ssize_t count
+    cdef list cache
+
+    def __init__(self):
+        raise TypeError("LazyRow objects can't be created directly")
+
+    @staticmethod
+    cdef LazyRow create(BufferIndex index, Py_ssize_t first, Py_ssize_t end):
+        cdef LazyRow row = LazyRow.__new__(LazyRow)
+        row.index = index
+        row.first = first
+        row.count = end - first
+        row.cache = None
+        return row
+
+    cdef object get(self, Py_ssize_t i):
+        cdef object value
+        if self.cache is None:
+            self.cache = [None] * self.count
+        else:
+            value = self.cache[i]
+            if value is not None:
+                return value
+
+        value = self.index.field_value(&self.index.fields[self.first + i])
+        self.cache[i] = value
+        return value
+
+    def __len__(self):
+        return self.count
+
+    def __getitem__(self, key):
+        cdef Py_ssize_t i
+        if isinstance(key, slice):
+            return [self.get(i) for i in range(*key.indices(self.count))]
+
+        i = key
+        if i < 0:
+            i += self.count
+        if i < 0 or i >= self.count:
+            raise IndexError("row index out of range")
+        return self.get(i)
+
+    def __iter__(self):
+        cdef Py_ssize_t i
+        for i in range(self.count):
+            yield self.get(i)
+
+    def tolist(self):
+        """Returns all values of the row as a list."""
+        cdef Py_ssize_t i
+        return [self.get(i) for i in range(self.count)]
+
+    def __eq__(self, other):
+        if isinstance(other, (LazyRow, list, tuple)):
+            return self.tolist() == list(other)
+        return NotImplemented
+
+    def __repr__(self):
+        return f"LazyRow({self.tolist()!r})"
+
+
+collections.abc.Sequence.register(LazyRow)
+
+
+async def index_chunks(reader, pydialect, bint views=False, Progress progress=None,
+                       Py_ssize_t min_chunk=0, executor=None):
+    """Reads data in chunks, and yields a BufferIndex of every chunk, which covers
+    all rows that end in it. Errors found in a chunk are raised after it's consumed.
+
+    With `views` set, every chunk is encoded to UTF-8 before indexing.
+    With `min_chunk`, reads are gathered until they're at least that long.
+    If `executor` is given, chunks are indexed on it."""
+    cdef unicode data
+    cdef unicode more
+    cdef list parts
+    cdef Py_ssize_t gathered
+    cdef object pending = b"" if views else u""
+    cdef bint force_save = False
+    cdef bint eof = False
+    cdef Source source
+    cdef BufferIndex index
+
+    while True:
+        data = <unicode?>(await reader.read(READ_SIZE))
+        eof = not data
+        if progress is not None and progress.due(len(data)):
+            await progress.report()
+
+        # Short reads, which can't complete the pending row, are gathered until there's
+        # as much new data as pending, so that long rows aren't re-indexed too often
+        while not eof and len(data) < len(pending) and u'\n' not in data and u'\r' not in data:
+            more = <unicode?>(await reader.read(READ_SIZE))
+            eof = not more
+            data += more
+            if progress is not None and progress.due(len(more)):
+                await progress.report()
+
+        if not eof and len(data) < min_chunk:
+            parts = [data]
+            gathered = len(data)
+            while not eof and gathered < min_chunk:
+                more = <unicode?>(await reader.read(max(READ_SIZE, min_chunk - gathered)))
+                eof = not more
+                gathered += len(more)
+                parts.append(more)
+                if progress is not None and progress.due(len(more)):
+                    await progress.report()
+            data = u"".join(parts)
+
+        source = Source(pending + (data.encode("utf-8") if views else data), "utf-8", pydialect)
+        index = BufferIndex(source, pydialect)
+        index.s.force_save_cell = force_save
+        if executor is None:
+            index.index(0, source.length)
+        else:
+            import asyncio
+            await asyncio.get_event_loop().run_in_executor(executor, index.index, 0,
+                                                             source.length)
+
+        if eof:
+            index.finish()
+
+        yield index
+        index.check_error()
+
+        if eof:
+            return
+
+        # Start the next chunk with the incomplete row
+        pending = source.obj[index.s.row_start_pos:]
+        force_save = index.s.row_start_force_save
+
+        # Source had to decode the chunk, as the dialect isn't ASCII-only
+        if views and isinstance(pending, unicode):
+            pending = pending.encode("utf-8")
+
+
+async def lazy_parser(reader, pydialect, bint views=False, Progress progress=None):
+    """Like `parser`, but yields LazyRow objects. Data is indexed in chunks,
+    every chunk is shared by all rows that end in it.
+
+    With `views` set, every chunk is encoded to UTF-8, and rows are lists of
+    bytes-like objects (see BufferIndex.view_rows)."""
+    cdef BufferIndex index
+
+    async for index in index_chunks(reader, pydialect, views, progress):
+        for row in (index.view_rows() if views else index.lazy_rows()):
+            if progress is not None:
+                progress.rows += 1
+            yield row
+
+    if progress is not None:
+        await progress.report()
+
+
+# Grouping indexed rows by key fields
+# ===================================
+#
+# Keys are hashed straight from the source (fields with quotes or escapes are unescaped
+# into a scratch buffer first) into an open-addressing table of 64-bit hashes.
+# Entries with an equal hash are compared with the stored keys character by character,
+# so Python objects are only created for keys seen for the first time.
+
+from cpython.ref cimport PyObject
+from libc.math cimport fabs
+from libc.stdint cimport uint64_t
+from libc.string cimport memcmp, memcpy
+
+cdef extern from "Python.h":
+    void PyUnicode_WRITE(int kind, void* data, Py_ssize_t index, Py_UCS4 value) nogil
+    double PyOS_string_to_double(const char* s, char** endptr,
+                                 PyObject* overflow_exception) except? -1.0
+
+DEF MIN_TABLE_CAPACITY = 64
+
+# Longest field converted to a float without creating a str
+DEF MAX_FAST_NUMBER = 63
+
+DEF FNV_OFFSET = 14695981039346656037
+DEF FNV_PRIME = 1099511628211
+
+
+cdef uint64_t hash_values(const FieldValue* values, Py_ssize_t n) noexcept nogil:
+    """FNV-1a of code points of the values, with a final avalanche (from MurmurHash3),
+    as the table is indexed by the lowest bits."""
+    cdef uint64_t h = <uint64_t>FNV_OFFSET
+    cdef Py_ssize_t i, j
+
+    cdef uint64_t c
+
+    for i in range(n):
+        for j in range(values[i].length):
+            c = PyUnicode_READ(values[i].kind, values[i].data, j)
+            h = (h ^ c) * <uint64_t>FNV_PRIME
+        # Separates values, so that ("ab", "c") and ("a", "bc") differ
+        h = (h ^ NOT_SET) * <uint64_t>FNV_PRIME
+
+    h ^= h >> 33
+    h *= 0xff51afd7ed558ccdULL
+    h ^= h >> 33
+    h *= 0xc4ceb9fe1a85ec53ULL
+    h ^= h >> 33
+    return h
+
+
+cdef bint value_equals(const FieldValue* a, const FieldValue* b) noexcept nogil:
+    cdef Py_ssize_t i
+
+    if a.length != b.length:
+        return False
+    elif a.kind == b.kind:
+        return a.length == 0 or memcmp(a.data, b.data, a.length * a.kind) == 0
+
+    for i in range(a.length):
+        if PyUnicode_READ(a.kind, a.data, i) != PyUnicode_READ(b.kind, b.data, i):
+            return False
+    return True
+
+
+cdef inline FieldValue str_value(unicode s) noexcept:
+    cdef FieldValue value
+    value.data = PyUnicode_DATA(s)
+    value.kind = PyUnicode_KIND(s)
+    value.length = PyUnicode_GET_LENGTH(s)
+    return value
+
+
+cdef bint values_equal(const FieldValue* values, Py_ssize_t n, tuple key) noexcept:
+    cdef FieldValue value
+    cdef Py_ssize_t i
+    for i in range(n):
+        value = str_value(<unicode>key[i])
+        if not value_equals(&values[i], &value):
+            return False
+    return True
+
+
+cdef inline unicode value_str(const FieldValue* value):
+    if value.length == 0:
+        return u""
+    return PyUnicode_FromKindAndData(value.kind, value.data, value.length)
+
+
+cdef tuple values_tuple(const FieldValue* values, Py_ssize_t n):
+    cdef Py_ssize_t i
+    return tuple([value_str(&values[i]) for i in range(n)])
+
+
+cdef int value_to_double(const FieldValue* value, double* out) except -1:
+    """Converts a value to a float, exactly like float(). Returns 0 (without touching out)
+    for empty values. Short ASCII values are converted without creating a str."""
+    cdef char buffer[MAX_FAST_NUMBER + 1]
+    cdef Py_UCS4 c
+    cdef Py_ssize_t i
+
+    if value.length == 0:
+        return 0
+
+    if value.length <= MAX_FAST_NUMBER:
+        for i in range(value.length):
+            c = PyUnicode_READ(value.kind, value.data, i)
+            if c >= 128:
+                break
+            buffer[i] = <char>c
+        else:
+            buffer[value.length] = 0
+            # Doesn't accept whitespace or underscores, unlike float() - those fall through
+            try:
+                out[0] = PyOS_string_to_double(buffer, NULL, NULL)
+                return 1
+            except ValueError:
+                pass
+
+    out[0] = float(value_str(value))
+    return 1
+
+
+cdef struct HashTable:
+    uint64_t* hashes
+    # Ids of stored entries, -1 in empty slots
+    Py_ssize_t* ids
+    # Always a power of 2
+    Py_ssize_t capacity
+    Py_ssize_t length
+
+
+cdef int table_init(HashTable* table, Py_ssize_t capacity) except -1:
+    cdef Py_ssize_t i
+    table.hashes = <uint64_t*>malloc(capacity * sizeof(uint64_t))
+    table.ids = <Py_ssize_t*>malloc(capacity * sizeof(Py_ssize_t))
+    if table.hashes == NULL or table.ids == NULL:
+        table_free(table)
+        raise MemoryError()
+
+    for i in range(capacity):
+        table.ids[i] = -1
+    table.capacity = capacity
+    table.length = 0
+    return 0
+
+
+cdef void table_free(HashTable* table) noexcept:
+    free(table.hashes)
+    free(table.ids)
+    table.hashes = NULL
+    table.ids = NULL
+    table.capacity = 0
+    table.length = 0
+
+
+cdef inline Py_ssize_t table_slot(const HashTable* table, uint64_t hash) noexcept nogil:
+    return <Py_ssize_t>(hash & <uint64_t>(table.capacity - 1))
+
+
+cdef inline Py_ssize_t table_next(const HashTable* table, uint64_t hash,
+                                  Py_ssize_t* slot) noexcept nogil:
+    """Returns the id of the next entry with the given hash, probing from *slot
+    (start with table_slot). Returns -1 once an empty slot is reached - *slot is then left
+    at it, ready for table_insert."""
+    cdef Py_ssize_t i, id
+    while True:
+        i = slot[0]
+        id = table.ids[i]
+        if id < 0:
+            return -1
+        slot[0] = (i + 1) & (table.capacity - 1)
+        if table.hashes[i] == hash:
+            return id
+
+
+cdef int table_grow(HashTable* table) except -1:
+    cdef HashTable grown
+    cdef Py_ssize_t i, slot
+
+    table_init(&grown, 2 * table.capacity)
+    for i in range(table.capacity):
+        if table.ids[i] >= 0:
+            slot = table_slot(&grown, table.hashes[i])
+            while grown.ids[slot] >= 0:
+                slot = (slot + 1) & (grown.capacity - 1)
+            grown.hashes[slot] = table.hashes[i]
+            grown.ids[slot] = table.ids[i]
+
+    grown.length = table.length
+    table_free(table)
+    table[0] = grown
+    return 0
+
+
+cdef int table_insert(HashTable* table, Py_ssize_t slot, uint64_t hash,
+                      Py_ssize_t id) except -1:
+    """Stores an entry in the empty slot found by table_next."""
+    # Keep at most half of the slots used, so that probe sequences stay short
+    if 2 * (table.length + 1) > table.capacity:
+        table_grow(table)
+        slot = table_slot(table, hash)
+        while table.ids[slot] >= 0:
+            slot = (slot + 1) & (table.capacity - 1)
+
+    table.hashes[slot] = hash
+    table.ids[slot] = id
+    table.length += 1
+    return 0
+
+
+cdef enum AggregateFunction:
+    AGGREGATE_COUNT
+    AGGREGATE_SUM
+    AGGREGATE_MIN
+    AGGREGATE_MAX
+    AGGREGATE_MEAN
+
+
+AGGREGATE_FUNCTIONS = {
+    "count": AggregateFunction.AGGREGATE_COUNT,
+    "sum": AggregateFunction.AGGREGATE_SUM,
+    "min": AggregateFunction.AGGREGATE_MIN,
+    "max": AggregateFunction.AGGREGATE_MAX,
+    "mean": AggregateFunction.AGGREGATE_MEAN,
+}
+
+
+cdef struct Accumulator:
+    double value
+    # Neumaier compensation of sums, just like in sum() since Python 3.12
+    double compensation
+    Py_ssize_t count
+
+
+cdef class Aggregator:
+    """Groups indexed rows by the values of key fields, and computes aggregates
+    of other fields in every group. Numbers are converted in C, and Python objects
+    are only created for keys of new groups.
+
+    `aggregates` is a sequence of (function, column) pairs, where function is
+    "count" (rows in the group; column is ignored), "sum", "min", "max" or "mean".
+    Empty fields are skipped by all functions but "count".
+    """
+    cdef Py_ssize_t* key_columns
+    cdef Py_ssize_t keys_len
+    cdef AggregateFunction* functions
+    cdef Py_ssize_t* columns
+    cdef Py_ssize_t aggregates_len
+    cdef FieldValue* values
+
+    cdef HashTable table
+    cdef Scratch scratch
+    # Key tuples of groups, in order of appearance
+    cdef list keys
+    # aggregates_len accumulators for every group
+    cdef Accumulator* accumulators
+    cdef Py_ssize_t accumulators_cap
+
+    def __cinit__(self, key_columns, aggregates):
+        cdef Py_ssize_t i
+        self.key_columns = NULL
+        self.functions = NULL
+        self.columns = NULL
+        self.values = NULL
+        self.table.hashes = NULL
+        self.table.ids = NULL
+        self.scratch.data = NULL
+        self.scratch.capacity = 0
+        self.keys = []
+        self.accumulators = NULL
+        self.accumulators_cap = 0
+
+        key_columns = list(key_columns)
+        aggregates = list(aggregates)
+        self.keys_len = len(key_columns)
+        self.aggregates_len = len(aggregates)
+
+        self.key_columns = <Py_ssize_t*>malloc((self.keys_len + 1) * sizeof(Py_ssize_t))
+        self.functions = <AggregateFunction*>malloc(
+            (self.aggregates_len + 1) * sizeof(AggregateFunction))
+        self.columns = <Py_ssize_t*>malloc((self.aggregates_len + 1) * sizeof(Py_ssize_t))
+        self.values = <FieldValue*>malloc((self.keys_len + 1) * sizeof(FieldValue))
+        if self.key_columns == NULL or self.functions == NULL or self.columns == NULL \
+                or self.values == NULL:
+            raise MemoryError()
+        table_init(&self.table, MIN_TABLE_CAPACITY)
+
+        for i in range(self.keys_len):
+            self.key_columns[i] = key_columns[i]
+            if self.key_columns[i] < 0:
+                raise ValueError("key column indices can't be negative")
+
+        for i, (function, column) in enumerate(aggregates):
+            if function not in AGGREGATE_FUNCTIONS:
+                raise ValueError(f"unknown aggregate function: {function!r}")
+            self.functions[i] = AGGREGATE_FUNCTIONS[function]
+            if self.functions[i] == AggregateFunction.AGGREGATE_COUNT:
+                self.columns[i] = 0
+            elif column is None or column < 0:
+                raise ValueError(f"{function} requires a non-negative column index")
+            else:
+                self.columns[i] = column
+
+    def __dealloc__(self):
+        free(self.key_columns)
+        free(self.functions)
+        free(self.columns)
+        free(self.values)
+        free(self.scratch.data)
+        free(self.accumulators)
+        table_free(&self.table)
+
+    def __len__(self):
+        return len(self.keys)
+
+    cdef Py_ssize_t add_group(self, Py_ssize_t slot, uint64_t hash) except -1:
+        cdef Py_ssize_t group = len(self.keys)
+        cdef Py_ssize_t i
+        cdef Py_ssize_t cap
+        cdef Accumulator* accumulators
+
+        if group >= self.accumulators_cap:
+            cap = max(MIN_TABLE_CAPACITY, 2 * self.accumulators_cap)
+            accumulators = <Accumulator*>realloc(
+                self.accumulators, cap * (self.aggregates_len + 1) * sizeof(Accumulator))
+            if accumulators == NULL:
+                raise MemoryError()
+            self.accumulators = accumulators
+            self.accumulators_cap = cap
+
+        for i in range(group * self.aggregates_len, (group + 1) * self.aggregates_len):
+            self.accumulators[i].value = 0.0
+            self.accumulators[i].compensation = 0.0
+            self.accumulators[i].count = 0
+
+        self.keys.append(values_tuple(self.values, self.keys_len))
+        table_insert(&self.table, slot, hash, group)
+        return group
+
+    def update(self, BufferIndex index, Py_ssize_t first_row=0):
+        """Adds non-empty rows of the index (starting with `first_row`) to their groups.
+        Only str sources are supported, and QUOTE_NONNUMERIC fields are treated as text."""
+        cdef Py_ssize_t r, a, group, slot
+        cdef Py_ssize_t first = 0
+        cdef uint64_t hash
+        cdef Accumulator* acc
+        cdef FieldValue value
+        cdef double number, total
+
+        if index.source.obj is None:
+            raise ValueError("source was released")
+        if index.source.utf8:
+            raise ValueError("only str sources can be aggregated")
+
+        for r in range(index.rows_len):
+            if r < first_row or index.rows[r] == first:
+                first = index.rows[r]
+                continue
+
+            index.field_values(first, index.rows[r], self.key_columns, self.keys_len,
+                               self.values, &self.scratch)
+            hash = hash_values(self.values, self.keys_len)
+            slot = table_slot(&self.table, hash)
+            while True:
+                group = table_next(&self.table, hash, &slot)
+                if group < 0:
+                    group = self.add_group(slot, hash)
+                    break
+                elif values_equal(self.values, self.keys_len, <tuple>self.keys[group]):
+                    break
+
+            acc = &self.accumulators[group * self.aggregates_len]
+            for a in range(self.aggregates_len):
+                if self.functions[a] == AggregateFunction.AGGREGATE_COUNT:
+                    acc[a].count += 1
+                    continue
+
+                index.field_values(first, index.rows[r], &self.columns[a], 1, &value,
+                                   &self.scratch)
+                if not value_to_double(&value, &number):
+                    continue
+
+                if self.functions[a] == AggregateFunction.AGGREGATE_MIN:
+                    if acc[a].count == 0 or number < acc[a].value:
+                        acc[a].value = number
+                elif self.functions[a] == AggregateFunction.AGGREGATE_MAX:
+                    if acc[a].count == 0 or number > acc[a].value:
+                        acc[a].value = number
                 else:
-                    cell += char
+                    total = acc[a].value + number
+                    if fabs(acc[a].value) >= fabs(number):
+                        acc[a].compensation += (acc[a].value - total) + number
+                    else:
+                        acc[a].compensation += (number - total) + acc[a].value
+                    acc[a].value = total
+                acc[a].count += 1
+
+            first = index.rows[r]
+
+    def result(self):
+        """Returns a list of (key, values) pairs of all groups, in order of appearance.
+        Keys are tuples of str; values are lists with a result of every aggregate:
+        an int for "count", a float for "sum", and a float or None (without any values)
+        for "min", "max" and "mean"."""
+        cdef list result = [None] * len(self.keys)
+        cdef list values
+        cdef Py_ssize_t group, a
+        cdef Accumulator* acc
+        cdef double total
+
+        for group in range(len(self.keys)):
+            acc = &self.accumulators[group * self.aggregates_len]
+            values = [None] * self.aggregates_len
+            for a in range(self.aggregates_len):
+                total = acc[a].value + acc[a].compensation
+                if self.functions[a] == AggregateFunction.AGGREGATE_COUNT:
+                    values[a] = acc[a].count
+                elif self.functions[a] == AggregateFunction.AGGREGATE_SUM:
+                    values[a] = total
+                elif acc[a].count == 0:
+                    pass
+                elif self.functions[a] == AggregateFunction.AGGREGATE_MEAN:
+                    values[a] = total / acc[a].count
+                else:
+                    values[a] = acc[a].value
+            result[group] = (self.keys[group], values)
+
+        return result
+
+
+# Joining indexed rows with a lookup table
+# ========================================
+#
+# Values of the lookup rows are packed one after another into a single character buffer,
+# which (just like a str) is widened to 2 or 4 bytes per character only once that's
+# needed. Every row is its key values followed by the selected values; the hash table
+# maps hashes of keys to row numbers, and ends of values within the buffer are kept
+# in a separate array.
+
+cdef struct PackedValues:
+    char* data
+    int kind
+    # All characters are in ASCII
+    bint ascii
+    Py_ssize_t length
+    Py_ssize_t capacity
+
+
+cdef int packed_reserve(PackedValues* packed, Py_ssize_t capacity, int kind) except -1:
+    """Makes room for `capacity` characters of (at least) `kind` bytes each."""
+    cdef char* data
+    cdef Py_ssize_t i
+
+    if kind > packed.kind:
+        capacity = max(capacity, packed.capacity)
+        data = <char*>malloc(capacity * kind)
+        if data == NULL:
+            raise MemoryError()
+        for i in range(packed.length):
+            PyUnicode_WRITE(kind, data, i, PyUnicode_READ(packed.kind, packed.data, i))
+        free(packed.data)
+        packed.data = data
+        packed.kind = kind
+        packed.capacity = capacity
+
+    elif capacity > packed.capacity:
+        capacity = max(capacity, 2 * packed.capacity)
+        data = <char*>realloc(packed.data, capacity * packed.kind)
+        if data == NULL:
+            raise MemoryError()
+        packed.data = data
+        packed.capacity = capacity
+
+    return 0
+
+
+cdef int packed_append(PackedValues* packed, const FieldValue* value) except -1:
+    cdef Py_UCS4 max_char = 0
+    cdef Py_ssize_t i
+
+    for i in range(value.length):
+        max_char = max(max_char, PyUnicode_READ(value.kind, value.data, i))
+    if max_char >= 128:
+        packed.ascii = False
+
+    packed_reserve(packed, packed.length + value.length,
+                   1 if max_char < 0x100 else 2 if max_char < 0x10000 else 4)
+
+    if value.kind == packed.kind:
+        if value.length:
+            memcpy(packed.data + packed.length * packed.kind, value.data,
+                   value.length * packed.kind)
+    else:
+        for i in range(value.length):
+            PyUnicode_WRITE(packed.kind, packed.data, packed.length + i,
+                            PyUnicode_READ(value.kind, value.data, i))
+
+    packed.length += value.length
+    return 0
+
 
-            elif state == ParserState.ESCAPE:
-                cell += char
-                state = ParserState.IN_CELL
+cdef class JoinTable:
+    """A lookup table of rows by their key fields, built from indexed chunks, which
+    enriches rows of other indexed chunks by values of the matching row.
+    Only the fields at `key_columns` and `columns` of every row are stored, packed into
+    a single buffer; the first row with a given key wins. Missing fields are empty.
+    """
+    cdef Py_ssize_t* all_columns
+    cdef readonly Py_ssize_t keys_len
+    cdef readonly Py_ssize_t width
+    cdef FieldValue* values
 
-            elif state == ParserState.IN_CELL_QUOTED:
-                # -- Inside a quoted cell --
+    cdef HashTable table
+    cdef Scratch scratch
+    cdef PackedValues packed
+    # End of every value (keys_len + width per row) within packed
+    cdef Py_ssize_t* ends
+    cdef Py_ssize_t rows_len
+    cdef Py_ssize_t rows_cap
 
-                # 1. Start of an escape
-                if char == dialect.escapechar:
-                    state = ParserState.ESCAPE_QUOTED
+    # Selected fields of the header row, set by whoever builds the table
+    cdef public object header
+
+    def __cinit__(self, key_columns, columns):
+        cdef Py_ssize_t i
+        cdef Py_ssize_t stride
+        self.all_columns = NULL
+        self.values = NULL
+        self.table.hashes = NULL
+        self.table.ids = NULL
+        self.scratch.data = NULL
+        self.scratch.capacity = 0
+        self.packed.data = NULL
+        self.packed.kind = 1
+        self.packed.ascii = True
+        self.packed.length = 0
+        self.packed.capacity = 0
+        self.ends = NULL
+        self.rows_len = 0
+        self.rows_cap = 0
+        self.header = None
+
+        all_columns = list(key_columns) + list(columns)
+        self.keys_len = len(key_columns)
+        self.width = len(columns)
+        stride = self.keys_len + self.width
+
+        self.all_columns = <Py_ssize_t*>malloc((stride + 1) * sizeof(Py_ssize_t))
+        self.values = <FieldValue*>malloc((stride + 1) * sizeof(FieldValue))
+        if self.all_columns == NULL or self.values == NULL:
+            raise MemoryError()
+        table_init(&self.table, MIN_TABLE_CAPACITY)
+
+        for i in range(stride):
+            self.all_columns[i] = all_columns[i]
+            if self.all_columns[i] < 0:
+                raise ValueError("column indices can't be negative")
+
+    def __dealloc__(self):
+        free(self.all_columns)
+        free(self.values)
+        free(self.scratch.data)
+        free(self.packed.data)
+        free(self.ends)
+        table_free(&self.table)
+
+    def __len__(self):
+        return self.rows_len
+
+    @property
+    def nbytes(self):
+        """Memory used by the stored rows and the hash table."""
+        return self.packed.capacity * self.packed.kind \
+            + self.rows_cap * (self.keys_len + self.width) * sizeof(Py_ssize_t) \
+            + self.table.capacity * (sizeof(uint64_t) + sizeof(Py_ssize_t))
+
+    cdef inline FieldValue stored(self, Py_ssize_t row, Py_ssize_t i) noexcept nogil:
+        """Returns value i (key values first) of a stored row."""
+        cdef Py_ssize_t n = row * (self.keys_len + self.width) + i
+        cdef Py_ssize_t start = self.ends[n - 1] if n > 0 else 0
+        cdef FieldValue value
+        value.data = self.packed.data + start * self.packed.kind
+        value.kind = self.packed.kind
+        value.length = self.ends[n] - start
+        return value
+
+    cdef Py_ssize_t find(self, const FieldValue* keys, uint64_t hash,
+                         Py_ssize_t* slot) noexcept nogil:
+        """Returns the row with the given key values, or -1 (with *slot at an empty slot
+        for that key)."""
+        cdef Py_ssize_t row, i
+        cdef FieldValue value
+        slot[0] = table_slot(&self.table, hash)
+
+        while True:
+            row = table_next(&self.table, hash, slot)
+            if row < 0:
+                return -1
+            for i in range(self.keys_len):
+                value = self.stored(row, i)
+                if not value_equals(&keys[i], &value):
+                    break
+            else:
+                return row
+
+    cdef bint store(self, const FieldValue* values, uint64_t hash) except -1:
+        """Stores a row of keys_len + width values (with the given hash of the keys),
+        unless a row with the same key is already stored. Returns True if it was stored."""
+        cdef Py_ssize_t stride = self.keys_len + self.width
+        cdef Py_ssize_t i, slot, cap
+        cdef Py_ssize_t* ends
+
+        if self.find(values, hash, &slot) >= 0:
+            return False
+
+        if self.rows_len >= self.rows_cap:
+            cap = max(MIN_TABLE_CAPACITY, 2 * self.rows_cap)
+            ends = <Py_ssize_t*>realloc(self.ends, cap * (stride + 1) * sizeof(Py_ssize_t))
+            if ends == NULL:
+                raise MemoryError()
+            self.ends = ends
+            self.rows_cap = cap
+
+        for i in range(stride):
+            packed_append(&self.packed, &values[i])
+            self.ends[self.rows_len * stride + i] = self.packed.length
+
+        table_insert(&self.table, slot, hash, self.rows_len)
+        self.rows_len += 1
+        return True
+
+    def add(self, BufferIndex index, Py_ssize_t first_row=0):
+        """Stores non-empty rows of the index (starting with `first_row`),
+        unless a row with the same key is already stored.
+        Only str sources are supported; QUOTE_NONNUMERIC fields are stored as text."""
+        cdef Py_ssize_t r
+        cdef Py_ssize_t first = 0
+
+        if index.source.obj is None:
+            raise ValueError("source was released")
+        if index.source.utf8:
+            raise ValueError("only str sources can be stored")
+
+        for r in range(index.rows_len):
+            if r >= first_row and index.rows[r] != first:
+                index.field_values(first, index.rows[r], self.all_columns,
+                                   self.keys_len + self.width, self.values, &self.scratch)
+                self.store(self.values, hash_values(self.values, self.keys_len))
+            first = index.rows[r]
+
+    def get(self, key):
+        """Returns the stored (non-key) values of the row with the given key (a sequence
+        of str), or None."""
+        cdef Py_ssize_t i, row, slot
+        cdef FieldValue value
+        key = tuple(key)
+        if len(key) != self.keys_len:
+            raise ValueError(f"expected a key of {self.keys_len} values, got {len(key)}")
+
+        for i in range(self.keys_len):
+            self.values[i] = str_value(<unicode?>key[i])
+        row = self.find(self.values, hash_values(self.values, self.keys_len), &slot)
+        if row < 0:
+            return None
+
+        result = [None] * self.width
+        for i in range(self.width):
+            value = self.stored(row, self.keys_len + i)
+            result[i] = value_str(&value)
+        return result
+
+    def join(self, BufferIndex index, Serializer serializer, key_columns, bint inner=False,
+             Py_ssize_t first_row=0):
+        """Serializes non-empty rows of the index (starting with `first_row`), followed by
+        the stored values of the row with the same key - or by empty strings, unless
+        `inner` is set, in which case rows without a match are skipped.
+        Nothing is converted into Python objects. Returns the number of written rows."""
+        cdef Py_ssize_t* columns = NULL
+        cdef Field* fields = NULL
+        cdef FieldValue* keys = NULL
+        cdef FieldValue value
+        cdef Py_UCS4* scratch_pos
+        cdef Py_ssize_t fields_cap = 0
+        cdef Py_ssize_t r, f, i, count, match, slot, needed
+        cdef Py_ssize_t first = 0
+        cdef Py_ssize_t written = 0
+        cdef bint ascii
+        cdef list strings = []
+
+        if index.source.obj is None:
+            raise ValueError("source was released")
+        if index.source.utf8:
+            raise ValueError("only str sources can be joined")
+        if len(key_columns) != self.keys_len:
+            raise ValueError(f"expected {self.keys_len} key columns, got {len(key_columns)}")
+        ascii = PyUnicode_IS_ASCII(index.source.obj)
+
+        try:
+            columns = <Py_ssize_t*>malloc((self.keys_len + 1) * sizeof(Py_ssize_t))
+            keys = <FieldValue*>malloc((self.keys_len + 1) * sizeof(FieldValue))
+            if columns == NULL or keys == NULL:
+                raise MemoryError()
+            for i in range(self.keys_len):
+                columns[i] = key_columns[i]
+                if columns[i] < 0:
+                    raise ValueError("key column indices can't be negative")
+
+            for r in range(index.rows_len):
+                if r < first_row or index.rows[r] == first:
+                    first = index.rows[r]
+                    continue
+
+                # 1. Find the matching row
+                index.field_values(first, index.rows[r], columns, self.keys_len, keys,
+                                   &self.scratch)
+                match = self.find(keys, hash_values(keys, self.keys_len), &slot)
+                if match < 0 and inner:
+                    first = index.rows[r]
+                    continue
 
-                # 2. Quotechar
-                elif dialect.quoting != ReadQuoting.NONE and char == dialect.quotechar and \
-                        dialect.doublequote:
-                    state = ParserState.QUOTE_IN_QUOTED
+                count = index.rows[r] - first + self.width
+                if count > fields_cap:
+                    fields_cap = max(count, 2 * fields_cap)
+                    free(fields)
+                    fields = <Field*>malloc(fields_cap * sizeof(Field))
+                    if fields == NULL:
+                        raise MemoryError()
 
-                # 3. Every other char
+                # 2. Fields of the row itself, unescaped into the (now reused) scratch buffer
+                needed = 0
+                for f in range(first, index.rows[r]):
+                    if index.fields[f].flags & FieldFlags.FIELD_COMPLEX:
+                        needed += index.fields[f].end - index.fields[f].start + 1
+                scratch_reserve(&self.scratch, needed)
+                scratch_pos = self.scratch.data
+                for f in range(first, index.rows[r]):
+                    index.transcribe_field(&index.fields[f], &fields[f - first], serializer,
+                                           ascii, &scratch_pos, strings)
+
+                # 3. Values of the matching row
+                for i in range(self.width):
+                    f = index.rows[r] - first + i
+                    if match < 0:
+                        serializer.prepare_field(u"", &fields[f], strings)
+                        continue
+                    value = self.stored(match, self.keys_len + i)
+                    fields[f].data = value.data
+                    fields[f].kind = value.kind
+                    fields[f].length = value.length
+                    fields[f].ascii = self.packed.ascii
+                    fields[f].quoted = serializer.quote_strings
+
+                serializer.write_fields(fields, count, strings)
+                if strings:
+                    del strings[:]
+                written += 1
+                first = index.rows[r]
+
+        finally:
+            free(columns)
+            free(keys)
+            free(fields)
+
+        return written
+
+
+# Skipping rows with repeated keys
+# ================================
+
+cdef class DistinctFilter:
+    """Remembers keys of rows (fields at `columns`, missing ones are empty), to skip rows
+    with keys seen before.
+
+    Keys are only kept as 64-bit hashes - so a row with a new key is skipped by mistake
+    with a probability of about n²/2⁶⁵ after n distinct keys - unless `exact` is set;
+    then keys are also packed into a JoinTable, and compared on equal hashes.
+    """
+    cdef Py_ssize_t* columns
+    cdef Py_ssize_t columns_len
+    cdef FieldValue* values
+    cdef HashTable table
+    cdef Scratch scratch
+    cdef JoinTable keys
+
+    def __cinit__(self, columns, bint exact=False):
+        cdef Py_ssize_t i
+        self.values = NULL
+        self.table.hashes = NULL
+        self.table.ids = NULL
+        self.scratch.data = NULL
+        self.scratch.capacity = 0
+        self.keys = None
+
+        columns = list(columns)
+        self.columns_len = len(columns)
+        self.columns = <Py_ssize_t*>malloc((self.columns_len + 1) * sizeof(Py_ssize_t))
+        self.values = <FieldValue*>malloc((self.columns_len + 1) * sizeof(FieldValue))
+        if self.columns == NULL or self.values == NULL:
+            raise MemoryError()
+
+        for i in range(self.columns_len):
+            self.columns[i] = columns[i]
+            if self.columns[i] < 0:
+                raise ValueError("column indices can't be negative")
+
+        if exact:
+            self.keys = JoinTable(columns, ())
+        else:
+            table_init(&self.table, MIN_TABLE_CAPACITY)
+
+    def __dealloc__(self):
+        free(self.columns)
+        free(self.values)
+        free(self.scratch.data)
+        table_free(&self.table)
+
+    def __len__(self):
+        """Number of distinct keys seen so far"""
+        return len(self.keys) if self.keys is not None else self.table.length
+
+    @property
+    def nbytes(self):
+        """Memory used by the stored keys."""
+        if self.keys is not None:
+            return self.keys.nbytes
+        return self.table.capacity * (sizeof(uint64_t) + sizeof(Py_ssize_t))
+
+    def select(self, BufferIndex index):
+        """Returns numbers of rows of the index, which are empty or have a new key
+        (the first of rows with the same key is kept). Keys of those rows are remembered."""
+        cdef list result = []
+        cdef Py_ssize_t r, slot
+        cdef Py_ssize_t first = 0
+        cdef uint64_t hash
+        cdef bint new
+
+        if index.source.obj is None:
+            raise ValueError("source was released")
+
+        for r in range(index.rows_len):
+            if index.rows[r] == first:
+                new = True
+            else:
+                index.field_values(first, index.rows[r], self.columns, self.columns_len,
+                                   self.values, &self.scratch)
+                hash = hash_values(self.values, self.columns_len)
+
+                if self.keys is not None:
+                    new = self.keys.store(self.values, hash)
                 else:
-                    cell += char
+                    slot = table_slot(&self.table, hash)
+                    new = table_next(&self.table, hash, &slot) < 0
+                    if new:
+                        table_insert(&self.table, slot, hash, 0)
 
-            elif state == ParserState.ESCAPE_QUOTED:
-                cell += char
-                state = ParserState.IN_CELL_QUOTED
+            if new:
+                result.append(r)
+            first = index.rows[r]
 
-            elif state == ParserState.QUOTE_IN_QUOTED:
-                # -- Quotechar in a quoted field --
-                # This state can only be entered with doublequote on
+        return result
 
-                # 1. Double-quote
-                if char == dialect.quotechar:
-                    cell += char
-                    state = ParserState.IN_CELL_QUOTED
 
-                # 2. End of a row
-                elif char == u'\r' or char == u'\n':
-                    row.append(cell)
-                    cell = u""
-                    force_save_cell = False
-                    state = ParserState.EAT_NEWLINE
+async def distinct_parser(reader, pydialect, DistinctFilter distinct, bint lazy=False,
+                          bint views=False, Progress progress=None):
+    """Like `lazy_parser`, but skips rows with keys seen before (see DistinctFilter),
+    before creating any objects for them. Rows are lists, unless `lazy` or `views` is set."""
+    cdef BufferIndex index
+    cdef list numbers
+
+    async for index in index_chunks(reader, pydialect, views, progress):
+        numbers = distinct.select(index)
+        if views:
+            rows = index.view_rows(numbers)
+        elif lazy:
+            rows = index.lazy_rows(numbers)
+        else:
+            rows = index.materialize(rows=numbers)
+
+        for row in rows:
+            if progress is not None:
+                progress.rows += 1
+            yield row
+
+    if progress is not None:
+        await progress.report()
+
+
+# Binary cache of parsed rows
+# ===========================
+#
+# A cache file (see aiocsv.cache) has a heap of UTF-8 encoded values of all fields
+# (unescaped, lone surrogates encoded like with "surrogatepass"), followed by
+# native int64 arrays: the end field of every row, and the end of every field in the heap;
+# and a byte of flags for every field. Indexed chunks are dumped one by one,
+# and the cache is read straight from a memory-mapped file.
+
+from libc.stdint cimport int64_t, uint8_t
+
+DEF CACHE_FIELD_NUMERIC = 1
 
-                # 3. End of a cell
-                elif char == dialect.delimiter:
-                    row.append(cell)
-                    cell = u""
-                    force_save_cell = False
-                    state = ParserState.AFTER_DELIM
 
-                # 4. Unescaped quotechar
+cdef Py_ssize_t encode_utf8(const FieldValue* value, char* out) noexcept nogil:
+    """Writes the value as UTF-8 into out (of at least 4 bytes per character).
+    Returns the number of written bytes."""
+    cdef Py_ssize_t i
+    cdef Py_ssize_t n = 0
+    cdef unsigned int c
+
+    for i in range(value.length):
+        c = PyUnicode_READ(value.kind, value.data, i)
+        if c < 0x80:
+            out[n] = <char>c
+            n += 1
+        elif c < 0x800:
+            out[n] = <char>(0xC0 | (c >> 6))
+            out[n + 1] = <char>(0x80 | (c & 0x3F))
+            n += 2
+        elif c < 0x10000:
+            out[n] = <char>(0xE0 | (c >> 12))
+            out[n + 1] = <char>(0x80 | ((c >> 6) & 0x3F))
+            out[n + 2] = <char>(0x80 | (c & 0x3F))
+            n += 3
+        else:
+            out[n] = <char>(0xF0 | (c >> 18))
+            out[n + 1] = <char>(0x80 | ((c >> 12) & 0x3F))
+            out[n + 2] = <char>(0x80 | ((c >> 6) & 0x3F))
+            out[n + 3] = <char>(0x80 | (c & 0x3F))
+            n += 4
+    return n
+
+
+def dump_index(BufferIndex index, Py_ssize_t first_field, Py_ssize_t heap_offset):
+    """Returns parts of a cache file with all rows of the index: (heap, row ends, field ends,
+    flags) - all bytes. Ends are offset by `first_field` and `heap_offset`, the number of fields
+    and heap bytes of previously dumped indices. Only str sources are supported.
+    Like materialize, rows before invalid data are dumped before csv.Error is raised."""
+    cdef Py_ssize_t f, r, length, bound
+    cdef Py_ssize_t heap_len = 0
+    cdef Py_ssize_t longest = 0
+    cdef int max_bytes
+    cdef FieldSpan* field
+    cdef FieldValue value
+    cdef Scratch scratch
+    cdef char* heap
+    cdef int64_t* row_ends
+    cdef int64_t* field_ends
+    cdef uint8_t* flags
+    cdef bytearray heap_buffer
+
+    if index.source.obj is None:
+        raise ValueError("source was released")
+    if index.source.utf8:
+        raise ValueError("only str sources can be dumped")
+
+    max_bytes = 1 if PyUnicode_IS_ASCII(index.source.obj) else index.source.kind + 1
+    bound = 0
+    for f in range(index.fields_len):
+        length = index.fields[f].end - index.fields[f].start + 1
+        bound += length * max_bytes
+        if index.fields[f].flags & FieldFlags.FIELD_COMPLEX:
+            longest = max(longest, length)
+
+    heap_buffer = bytearray(bound)
+    row_bytes = bytearray(index.rows_len * sizeof(int64_t))
+    field_bytes = bytearray(index.fields_len * sizeof(int64_t))
+    flag_bytes = bytearray(index.fields_len)
+    heap = heap_buffer
+    row_ends = <int64_t*><char*>row_bytes
+    field_ends = <int64_t*><char*>field_bytes
+    flags = <uint8_t*><char*>flag_bytes
+
+    # Reserved up front, so that the copy runs without the GIL
+    scratch.data = NULL
+    scratch.capacity = 0
+    try:
+        scratch_reserve(&scratch, longest)
+        with nogil:
+            for f in range(index.fields_len):
+                field = &index.fields[f]
+                if field.flags & FieldFlags.FIELD_COMPLEX:
+                    value.data = scratch.data
+                    value.kind = 4
+                    value.length = unescape_into(index.source.data, index.source.kind,
+                                                 field.start, field.end, &index.dialect,
+                                                 scratch.data)
                 else:
-                    cell += char
-                    state = ParserState.IN_CELL
+                    value.data = <const char*>index.source.data + field.start * index.source.kind
+                    value.kind = index.source.kind
+                    value.length = field.end - field.start
 
-                    if dialect.strict:
-                        raise csv.Error(
-                            f"'{dialect.delimiter}' expected after '{dialect.quotechar}'"
-                        )
+                heap_len += encode_utf8(&value, heap + heap_len)
+                field_ends[f] = heap_offset + heap_len
+                flags[f] = CACHE_FIELD_NUMERIC if field.flags & FieldFlags.FIELD_NUMERIC else 0
 
-            else:
-                raise RuntimeError("wtf")
+            for r in range(index.rows_len):
+                row_ends[r] = first_field + index.rows[r]
+    finally:
+        free(scratch.data)
 
-        # Read more data
-        data = <unicode?>(await reader.read(READ_SIZE))
+    index.check_error()
+    del heap_buffer[heap_len:]
+    return bytes(heap_buffer), bytes(row_bytes), bytes(field_bytes), bytes(flag_bytes)
+
+
+cdef class CachedRows:
+    """Rows of a cache file, decoded straight from a buffer (e.g. an mmap).
+    Offsets of the parts are stored in the trailer of the file; they're validated,
+    and so are all ends, so that a corrupted file can't cause out-of-bounds reads."""
+    cdef Py_buffer view
+    cdef bint has_view
+    cdef const char* heap
+    cdef const int64_t* row_ends
+    cdef const int64_t* field_ends
+    cdef const uint8_t* flags
+    cdef readonly Py_ssize_t rows_len
+    cdef readonly Py_ssize_t fields_len
+    cdef readonly Py_ssize_t heap_len
+    cdef readonly object obj
+    cdef Py_ssize_t heap_start
+    # memoryview over the heap, created on demand; keeps the buffer exported
+    cdef object memview
+
+    def __cinit__(self, obj, Py_ssize_t heap_start, Py_ssize_t heap_len, Py_ssize_t rows_start,
+                  Py_ssize_t rows_len, Py_ssize_t fields_len):
+        cdef Py_ssize_t i, remaining, fields_start, flags_start
+        cdef int64_t previous
+        cdef Py_ssize_t end_size = sizeof(int64_t)
+        self.has_view = False
+        self.memview = None
+        self.obj = obj
+        self.heap_start = heap_start
+
+        PyObject_GetBuffer(obj, &self.view, PyBUF_SIMPLE)
+        self.has_view = True
+
+        # Lengths are checked against the space left, as offsets computed from
+        # a corrupted trailer could overflow
+        if heap_start < 0 or heap_len < 0 or rows_len < 0 or fields_len < 0 \
+                or heap_start > rows_start or heap_len > rows_start - heap_start \
+                or rows_start % end_size or rows_start > self.view.len:
+            raise ValueError("invalid cache file layout")
+        remaining = self.view.len - rows_start
+        if rows_len > remaining // end_size:
+            raise ValueError("invalid cache file layout")
+        remaining -= rows_len * end_size
+        if fields_len > remaining // (end_size + 1):
+            raise ValueError("invalid cache file layout")
+        fields_start = rows_start + rows_len * end_size
+        flags_start = fields_start + fields_len * end_size
+
+        self.heap = <const char*>self.view.buf + heap_start
+        self.row_ends = <const int64_t*>(<const char*>self.view.buf + rows_start)
+        self.field_ends = <const int64_t*>(<const char*>self.view.buf + fields_start)
+        self.flags = <const uint8_t*>self.view.buf + flags_start
+        self.rows_len = rows_len
+        self.fields_len = fields_len
+        self.heap_len = heap_len
+
+        previous = 0
+        for i in range(rows_len):
+            if self.row_ends[i] < previous or self.row_ends[i] > fields_len:
+                raise ValueError("invalid row ends in cache file")
+            previous = self.row_ends[i]
+        if rows_len and previous != fields_len:
+            raise ValueError("invalid row ends in cache file")
+
+        previous = 0
+        for i in range(fields_len):
+            if self.field_ends[i] < previous or self.field_ends[i] > heap_len:
+                raise ValueError("invalid field ends in cache file")
+            previous = self.field_ends[i]
+
+    def __dealloc__(self):
+        self.release()
+
+    def release(self):
+        """Releases the underlying buffer. Memoryviews returned with `views`
+        keep it exported until they're released."""
+        if self.memview is not None:
+            self.memview.release()
+            self.memview = None
+        if self.has_view:
+            PyBuffer_Release(&self.view)
+            self.has_view = False
+        self.obj = None
+        self.rows_len = 0
+
+    def __len__(self):
+        return self.rows_len
+
+    def materialize(self, Py_ssize_t start, Py_ssize_t stop, bint views=False):
+        """Returns a list of rows start:stop. With `views` set, fields are memoryviews
+        of the UTF-8 encoded values (and numbers aren't converted to floats)."""
+        cdef Py_ssize_t r, f, first, field_start
+        cdef list result
+        cdef list row
+        cdef object value
+
+        start = max(0, min(start, self.rows_len))
+        stop = max(start, min(stop, self.rows_len))
+        result = [None] * (stop - start)
+        if views and self.memview is None:
+            self.memview = memoryview(self.obj).cast("B")[
+                self.heap_start:self.heap_start + self.heap_len]
+
+        for r in range(start, stop):
+            first = self.row_ends[r - 1] if r > 0 else 0
+            row = [None] * (self.row_ends[r] - first)
+
+            for f in range(first, self.row_ends[r]):
+                field_start = self.field_ends[f - 1] if f > 0 else 0
+                if views:
+                    value = self.memview[field_start:self.field_ends[f]]
+                else:
+                    value = PyUnicode_DecodeUTF8(self.heap + field_start,
+                                                 self.field_ends[f] - field_start,
+                                                 "surrogatepass")
+                    if self.flags[f] & CACHE_FIELD_NUMERIC:
+                        value = float(value)
+                row[f - first] = value
 
-    if cell or force_save_cell:
-        row.append(float(cell) if numeric_cell else cell)
-    if row:
-        yield row
+            result[r - start] = row
 
+        return result
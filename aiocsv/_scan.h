@@ -0,0 +1,272 @@
+/* Block kernels for scanning 1-byte sources (latin-1 str or UTF-8 bytes) - used by _parser.pyx.
+ *
+ * The kernels (_scan_kernels.h) are compiled once per variant - for x86-64: portable C, SSE2
+ * (the baseline), SSE4.2 (with PCLMUL and POPCNT), AVX2 and AVX-512; for ARM64: portable C
+ * and NEON. Variants beyond the baseline get their instructions from target attributes,
+ * not compiler flags, so one build runs everywhere. aiocsv_scan_select picks the fastest
+ * one the CPU (and OS) supports, checked with cpuid, when _parser is imported. */
+
+#ifndef AIOCSV_SCAN_H
+#define AIOCSV_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AIOCSV_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AIOCSV_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AIOCSV_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* CPU features required by the variants */
+#define AIOCSV_CPU_SSE42 1   /* SSE4.2, PCLMUL and POPCNT */
+#define AIOCSV_CPU_AVX2 2    /* AVX2, saved by the OS */
+#define AIOCSV_CPU_AVX512 4  /* AVX-512 F and BW, saved by the OS */
+
+/* Number of trailing zero bits, x must not be 0 */
+static inline int aiocsv_ctz(uint64_t x) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (int)i;
+#elif defined(_MSC_VER)
+    /* No 64-bit bit scan on 32-bit targets */
+    unsigned long i;
+    if (_BitScanForward(&i, (unsigned long)x))
+        return (int)i;
+    _BitScanForward(&i, (unsigned long)(x >> 32));
+    return (int)i + 32;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+#if defined(AIOCSV_NEON)
+/* Equivalent of _mm_movemask_epi8 for 4 vectors of 0x00/0xFF bytes */
+static inline uint64_t aiocsv_neon_mask64(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2,
+                                          uint8x16_t m3) {
+    const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, bits), vandq_u8(m1, bits));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, bits), vandq_u8(m3, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+#endif
+
+#if defined(AIOCSV_X86_64) && !defined(_MSC_VER)
+#define AIOCSV_TARGET_ATTRIBUTE(features) __attribute__((target(features)))
+#else
+/* MSVC accepts intrinsics of any instruction set without flags */
+#define AIOCSV_TARGET_ATTRIBUTE(features)
+#endif
+
+/* Portable C */
+#define AIOCSV_KERNEL(name) aiocsv_##name##_c
+#define AIOCSV_TARGET
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+
+#if defined(AIOCSV_X86_64) || defined(AIOCSV_SSE2)
+#define AIOCSV_KERNEL(name) aiocsv_##name##_sse2
+#define AIOCSV_TARGET
+#define AIOCSV_USE_SSE2 1
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+#undef AIOCSV_USE_SSE2
+#endif
+
+#if defined(AIOCSV_X86_64)
+#define AIOCSV_KERNEL(name) aiocsv_##name##_sse42
+#define AIOCSV_TARGET AIOCSV_TARGET_ATTRIBUTE("sse4.2,pclmul,popcnt")
+#define AIOCSV_USE_SSE2 1
+#define AIOCSV_USE_CLMUL 1
+#define AIOCSV_USE_POPCNT 1
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+#undef AIOCSV_USE_SSE2
+
+#define AIOCSV_KERNEL(name) aiocsv_##name##_avx2
+#define AIOCSV_TARGET AIOCSV_TARGET_ATTRIBUTE("avx2,pclmul,popcnt")
+#define AIOCSV_USE_AVX2 1
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+#undef AIOCSV_USE_AVX2
+
+#define AIOCSV_KERNEL(name) aiocsv_##name##_avx512
+#define AIOCSV_TARGET AIOCSV_TARGET_ATTRIBUTE("avx512f,avx512bw,pclmul,popcnt")
+#define AIOCSV_USE_AVX512 1
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+#undef AIOCSV_USE_AVX512
+#undef AIOCSV_USE_CLMUL
+#undef AIOCSV_USE_POPCNT
+#endif
+
+#if defined(AIOCSV_NEON)
+#define AIOCSV_KERNEL(name) aiocsv_##name##_neon
+#define AIOCSV_TARGET
+#define AIOCSV_USE_NEON 1
+#if defined(__ARM_FEATURE_AES)
+#define AIOCSV_USE_PMULL 1
+#endif
+#include "_scan_kernels.h"
+#undef AIOCSV_KERNEL
+#undef AIOCSV_TARGET
+#undef AIOCSV_USE_NEON
+#undef AIOCSV_USE_PMULL
+#endif
+
+typedef struct {
+    const char* name;
+    unsigned required;  /* AIOCSV_CPU_* */
+    size_t (*find_any4)(const uint8_t*, size_t, size_t, uint8_t, uint8_t, uint8_t, uint8_t);
+    size_t (*count_byte)(const uint8_t*, size_t, size_t, uint8_t);
+    size_t (*find_newline_outside_quotes)(const uint8_t*, size_t, size_t, uint8_t, int*);
+} aiocsv_scan_variant;
+
+#define AIOCSV_VARIANT(name, suffix, required) \
+    {name, required, aiocsv_find_any4_##suffix, aiocsv_count_byte_##suffix, \
+     aiocsv_find_newline_outside_quotes_##suffix}
+
+/* From the slowest to the fastest */
+static const aiocsv_scan_variant aiocsv_scan_variants[] = {
+    AIOCSV_VARIANT("c", c, 0),
+#if defined(AIOCSV_X86_64) || defined(AIOCSV_SSE2)
+    AIOCSV_VARIANT("sse2", sse2, 0),
+#endif
+#if defined(AIOCSV_X86_64)
+    AIOCSV_VARIANT("sse4.2", sse42, AIOCSV_CPU_SSE42),
+    AIOCSV_VARIANT("avx2", avx2, AIOCSV_CPU_SSE42 | AIOCSV_CPU_AVX2),
+    AIOCSV_VARIANT("avx512", avx512, AIOCSV_CPU_SSE42 | AIOCSV_CPU_AVX2 | AIOCSV_CPU_AVX512),
+#endif
+#if defined(AIOCSV_NEON)
+    AIOCSV_VARIANT("neon", neon, 0),
+#endif
+};
+
+#define AIOCSV_SCAN_VARIANTS \
+    ((int)(sizeof(aiocsv_scan_variants) / sizeof(aiocsv_scan_variants[0])))
+
+/* Variant in use, the portable one until aiocsv_scan_select is called */
+static const aiocsv_scan_variant* aiocsv_scan = &aiocsv_scan_variants[0];
+
+#if defined(AIOCSV_X86_64)
+static void aiocsv_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    memcpy(regs, out, sizeof(out));
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Register state enabled by the OS (XCR0) */
+static uint64_t aiocsv_xgetbv(void) {
+#if defined(_MSC_VER)
+    return (uint64_t)_xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t)hi << 32 | lo;
+#endif
+}
+#endif
+
+static unsigned aiocsv_cpu_features(void) {
+    unsigned features = 0;
+#if defined(AIOCSV_X86_64)
+    unsigned leaf1[4], leaf7[4] = {0, 0, 0, 0};
+    uint64_t xcr0 = 0;
+
+    aiocsv_cpuid(0, 0, leaf1);
+    if (leaf1[0] >= 7)
+        aiocsv_cpuid(7, 0, leaf7);
+    aiocsv_cpuid(1, 0, leaf1);
+
+    /* ECX: PCLMUL (1), SSE4.2 (20), POPCNT (23), OSXSAVE (27), AVX (28) */
+    if ((leaf1[2] & (1u << 1 | 1u << 20 | 1u << 23)) == (1u << 1 | 1u << 20 | 1u << 23))
+        features |= AIOCSV_CPU_SSE42;
+    if (leaf1[2] & 1u << 27)
+        xcr0 = aiocsv_xgetbv();
+
+    /* XMM and YMM state; EBX of leaf 7: AVX2 (5) */
+    if ((leaf1[2] & 1u << 28) && (xcr0 & 0x6) == 0x6 && (leaf7[1] & 1u << 5))
+        features |= AIOCSV_CPU_AVX2;
+    /* Opmask and ZMM state too; AVX512F (16), AVX512BW (30) */
+    if ((features & AIOCSV_CPU_AVX2) && (xcr0 & 0xE6) == 0xE6
+        && (leaf7[1] & (1u << 16 | 1u << 30)) == (1u << 16 | 1u << 30))
+        features |= AIOCSV_CPU_AVX512;
+#endif
+    return features;
+}
+
+static inline int aiocsv_scan_supported(int i) {
+    return (aiocsv_scan_variants[i].required & ~aiocsv_cpu_features()) == 0;
+}
+
+static inline const char* aiocsv_scan_variant_name(int i) {
+    return aiocsv_scan_variants[i].name;
+}
+
+static inline const char* aiocsv_scan_name(void) {
+    return aiocsv_scan->name;
+}
+
+/* Switches to the variant with the given name, or to the fastest supported one if name
+ * is NULL. Returns -1 if there's no such variant, and -2 if the CPU doesn't support it. */
+static int aiocsv_scan_select(const char* name) {
+    int i;
+    if (name == NULL) {
+        for (i = AIOCSV_SCAN_VARIANTS - 1; i > 0 && !aiocsv_scan_supported(i); i--)
+            ;
+        aiocsv_scan = &aiocsv_scan_variants[i];
+        return 0;
+    }
+    for (i = 0; i < AIOCSV_SCAN_VARIANTS; i++) {
+        if (strcmp(aiocsv_scan_variants[i].name, name) == 0) {
+            if (!aiocsv_scan_supported(i))
+                return -2;
+            aiocsv_scan = &aiocsv_scan_variants[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline size_t aiocsv_find_any4(const uint8_t* p, size_t i, size_t n, uint8_t a, uint8_t b,
+                                      uint8_t c, uint8_t d) {
+    return aiocsv_scan->find_any4(p, i, n, a, b, c, d);
+}
+
+static inline size_t aiocsv_count_byte(const uint8_t* p, size_t i, size_t n, uint8_t c) {
+    return aiocsv_scan->count_byte(p, i, n, c);
+}
+
+static inline size_t aiocsv_find_newline_outside_quotes(const uint8_t* p, size_t i, size_t n,
+                                                        uint8_t quote, int* odd) {
+    return aiocsv_scan->find_newline_outside_quotes(p, i, n, quote, odd);
+}
+
+#endif /* AIOCSV_SCAN_H */
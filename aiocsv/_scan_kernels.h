@@ -0,0 +1,197 @@
+/* Block kernels for scanning 1-byte sources - included by _scan.h once per variant, with:
+ * - AIOCSV_KERNEL(name): name suffixed with the variant,
+ * - AIOCSV_TARGET: attributes enabling the variant's instructions in its functions,
+ * - AIOCSV_USE_SSE2, AIOCSV_USE_AVX2, AIOCSV_USE_AVX512 or AIOCSV_USE_NEON: vectors used
+ *   for comparisons (scalar code if none is defined),
+ * - AIOCSV_USE_CLMUL or AIOCSV_USE_PMULL: carry-less multiplication for prefix XORs,
+ * - AIOCSV_USE_POPCNT: the popcnt instruction.
+ *
+ * Bytes are compared 16 to 64 at a time, producing bitmasks (bit i set if byte i matched).
+ * Quote parity of a 64-byte block is the prefix XOR of its quote mask: bit i is set
+ * if an odd number of quotes is at positions <= i, i.e. position i is inside quotes.
+ * That's a carry-less multiplication by all ones, if the CPU has one. */
+
+static inline AIOCSV_TARGET int AIOCSV_KERNEL(popcount)(uint64_t x) {
+#if defined(_MSC_VER) && defined(AIOCSV_USE_POPCNT) && defined(_M_X64)
+    return (int)__popcnt64(x);
+#elif defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    x -= (x >> 1) & 0x5555555555555555ULL;
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Bit i is set if an odd number of bits at positions <= i is set in x */
+static inline AIOCSV_TARGET uint64_t AIOCSV_KERNEL(prefix_xor)(uint64_t x) {
+#if defined(AIOCSV_USE_CLMUL)
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)x),
+                                           _mm_set1_epi8((char)0xFF), 0);
+    return (uint64_t)_mm_cvtsi128_si64(product);
+#elif defined(AIOCSV_USE_PMULL)
+    poly128_t product = vmull_p64((poly64_t)x, (poly64_t)UINT64_MAX);
+    return vgetq_lane_u64(vreinterpretq_u64_p128(product), 0);
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+/* Mask of the bytes in p[0:64] equal to a or b */
+static inline AIOCSV_TARGET uint64_t AIOCSV_KERNEL(mask64)(const uint8_t* p, uint8_t a,
+                                                            uint8_t b) {
+#if defined(AIOCSV_USE_AVX512)
+    __m512i v = _mm512_loadu_si512((const void*)p);
+    return (uint64_t)(_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8((char)a))
+                      | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8((char)b)));
+#elif defined(AIOCSV_USE_AVX2)
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    uint32_t lo_mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(lo, va), _mm256_cmpeq_epi8(lo, vb)));
+    uint32_t hi_mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(hi, va), _mm256_cmpeq_epi8(hi, vb)));
+    return (uint64_t)lo_mask | (uint64_t)hi_mask << 32;
+#elif defined(AIOCSV_USE_SSE2)
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    uint64_t mask = 0;
+    int i;
+    for (i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << (16 * i);
+    }
+    return mask;
+#elif defined(AIOCSV_USE_NEON)
+    const uint8x16_t va = vdupq_n_u8(a);
+    const uint8x16_t vb = vdupq_n_u8(b);
+    uint8x16_t m[4];
+    int i;
+    for (i = 0; i < 4; i++) {
+        uint8x16_t v = vld1q_u8(p + 16 * i);
+        m[i] = vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb));
+    }
+    return aiocsv_neon_mask64(m[0], m[1], m[2], m[3]);
+#else
+    uint64_t mask = 0;
+    int i;
+    for (i = 0; i < 64; i++)
+        mask |= (uint64_t)(p[i] == a || p[i] == b) << i;
+    return mask;
+#endif
+}
+
+/* Position of the first byte equal to a, b, c or d in p[i:n], or n. Compares at most
+ * one vector at a time, as the searched runs (cell contents) are usually short. */
+static AIOCSV_TARGET size_t AIOCSV_KERNEL(find_any4)(const uint8_t* p, size_t i, size_t n,
+                                                     uint8_t a, uint8_t b, uint8_t c,
+                                                     uint8_t d) {
+#if defined(AIOCSV_USE_AVX512)
+    const __m512i va = _mm512_set1_epi8((char)a);
+    const __m512i vb = _mm512_set1_epi8((char)b);
+    const __m512i vc = _mm512_set1_epi8((char)c);
+    const __m512i vd = _mm512_set1_epi8((char)d);
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(p + i));
+        uint64_t mask = (uint64_t)(_mm512_cmpeq_epi8_mask(v, va) | _mm512_cmpeq_epi8_mask(v, vb)
+                                   | _mm512_cmpeq_epi8_mask(v, vc)
+                                   | _mm512_cmpeq_epi8_mask(v, vd));
+        if (mask)
+            return i + (size_t)aiocsv_ctz(mask);
+    }
+#elif defined(AIOCSV_USE_AVX2)
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    const __m256i vc = _mm256_set1_epi8((char)c);
+    const __m256i vd = _mm256_set1_epi8((char)d);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, vc), _mm256_cmpeq_epi8(v, vd)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+        if (mask)
+            return i + (size_t)aiocsv_ctz(mask);
+    }
+#elif defined(AIOCSV_USE_SSE2)
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    const __m128i vc = _mm_set1_epi8((char)c);
+    const __m128i vd = _mm_set1_epi8((char)d);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+        int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return i + (size_t)aiocsv_ctz((uint64_t)mask);
+    }
+#elif defined(AIOCSV_USE_NEON)
+    const uint8x16_t va = vdupq_n_u8(a);
+    const uint8x16_t vb = vdupq_n_u8(b);
+    const uint8x16_t vc = vdupq_n_u8(c);
+    const uint8x16_t vd = vdupq_n_u8(d);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)),
+                                vorrq_u8(vceqq_u8(v, vc), vceqq_u8(v, vd)));
+        /* 4 bits per byte */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m),
+                                                                       4)), 0);
+        if (mask)
+            return i + (size_t)(aiocsv_ctz(mask) >> 2);
+    }
+#endif
+    for (; i < n; i++) {
+        if (p[i] == a || p[i] == b || p[i] == c || p[i] == d)
+            break;
+    }
+    return i;
+}
+
+/* Number of bytes equal to c in p[i:n] */
+static AIOCSV_TARGET size_t AIOCSV_KERNEL(count_byte)(const uint8_t* p, size_t i, size_t n,
+                                                      uint8_t c) {
+    size_t count = 0;
+    for (; i + 64 <= n; i += 64)
+        count += (size_t)AIOCSV_KERNEL(popcount)(AIOCSV_KERNEL(mask64)(p + i, c, c));
+    for (; i < n; i++)
+        count += p[i] == c;
+    return count;
+}
+
+/* Position of the first CR or LF outside of quotes in p[i:n], assuming an odd number
+ * of quotes precedes i if *odd is set; or the first 64-byte block boundary <= n, past
+ * which the rest (shorter than a block) has to be checked by the caller. *odd is updated
+ * to the parity before the returned position. Set quote to one of CR/LF if there's none. */
+static AIOCSV_TARGET size_t AIOCSV_KERNEL(find_newline_outside_quotes)(const uint8_t* p,
+                                                                       size_t i, size_t n,
+                                                                       uint8_t quote,
+                                                                       int* odd) {
+    uint64_t inside = *odd ? UINT64_MAX : 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t quotes = quote == '\r' || quote == '\n'
+            ? 0 : AIOCSV_KERNEL(mask64)(p + i, quote, quote);
+        uint64_t newlines = AIOCSV_KERNEL(mask64)(p + i, '\r', '\n');
+        uint64_t parity = AIOCSV_KERNEL(prefix_xor)(quotes) ^ inside;
+        uint64_t outside = newlines & ~parity;
+        if (outside) {
+            *odd = 0;
+            return i + (size_t)aiocsv_ctz(outside);
+        }
+        /* Broadcast the parity after the last byte */
+        inside = (uint64_t)0 - (parity >> 63);
+    }
+    *odd = (int)(inside & 1);
+    return i;
+}
@@ -0,0 +1,69 @@
+# Declarations shared with _parser.pyx, which serializes indexed fields directly
+
+cdef enum:
+    MAX_SPECIAL_NON_ASCII = 16
+    MAX_LINETERMINATOR = 16
+
+
+cdef enum WriteQuoting:
+    MINIMAL
+    ALL
+    NONNUMERIC
+    NONE
+
+
+cdef enum FieldError:
+    OK
+    NEED_ESCAPE
+    SURROGATE
+    EMPTY_RECORD
+
+
+cdef struct CDialect:
+    bint doublequote
+    WriteQuoting quoting
+    Py_UCS4 delimiter
+    Py_UCS4 quotechar
+    Py_UCS4 escapechar
+
+    # special_ascii[c] is set if ASCII character c requires quoting or escaping
+    bint special_ascii[128]
+    # Special characters outside of ASCII
+    Py_UCS4 special_non_ascii[MAX_SPECIAL_NON_ASCII]
+    int special_non_ascii_count
+
+    const char* lineterminator
+    Py_ssize_t lineterminator_length
+    # The line terminator for str output
+    Py_UCS4 lineterminator_text[MAX_LINETERMINATOR]
+    Py_ssize_t lineterminator_chars
+    Py_UCS4 lineterminator_max
+
+
+cdef struct Field:
+    # Contents of the field; data is NULL for empty fields
+    const void* data
+    Py_ssize_t length
+    int kind
+    bint ascii
+
+    # Filled in by measure_field
+    bint quoted
+    bint plain
+    Py_ssize_t out_length
+
+
+cdef class Serializer:
+    cdef CDialect dialect
+    cdef bytes lineterminator
+    cdef readonly bytearray buffer
+    cdef readonly Py_ssize_t used
+    # Strings are always quoted (QUOTE_ALL and QUOTE_NONNUMERIC)
+    cdef readonly bint quote_strings
+
+    cdef char* reserve(self, Py_ssize_t length) except NULL
+    cdef int prepare_field(self, object obj, Field* f, list strings) except -1
+    cdef int write_fields(self, Field* fields, Py_ssize_t count, list strings) except -1
+    cdef int raise_error(self, FieldError err, list strings) except -1
+    cdef tuple row_to_tuple(self, row)
+    cpdef writerow(self, row)
@@ -0,0 +1,532 @@
+import csv
+
+from cpython.bytearray cimport PyByteArray_AS_STRING, PyByteArray_GET_SIZE, PyByteArray_Resize
+from cpython.bytes cimport PyBytes_AS_STRING, PyBytes_FromStringAndSize
+from cpython.mem cimport PyMem_Free, PyMem_Malloc
+from libc.string cimport memcpy
+
+cdef extern from "Python.h":
+    Py_ssize_t PyUnicode_GET_LENGTH(object)
+    int PyUnicode_KIND(object)
+    void* PyUnicode_DATA(object)
+    bint PyUnicode_IS_ASCII(object)
+    Py_UCS4 PyUnicode_READ(int kind, const void* data, Py_ssize_t index) nogil
+    void PyUnicode_WRITE(int kind, void* data, Py_ssize_t index, Py_UCS4 value) nogil
+    object PyUnicode_New(Py_ssize_t size, Py_UCS4 maxchar)
+    bint PyNumber_Check(object)
+
+DEF NOT_SET = 0xFFFFFFFF
+DEF MIN_BUFFER_SIZE = 4096
+
+# Enums and structs are declared in _serializer.pxd
+
+
+cdef inline Py_ssize_t utf8_length(Py_UCS4 c) noexcept nogil:
+    if c < 0x80:
+        return 1
+    elif c < 0x800:
+        return 2
+    elif c < 0x10000:
+        return 3
+    else:
+        return 4
+
+
+cdef inline char* put_utf8(char* out, Py_UCS4 ch) noexcept nogil:
+    # Py_UCS4 is treated as a 1-character string when shifted
+    cdef unsigned int c = <unsigned int>ch
+
+    if c < 0x80:
+        out[0] = <char>c
+        return out + 1
+    elif c < 0x800:
+        out[0] = <char>(0xC0 | (c >> 6))
+        out[1] = <char>(0x80 | (c & 0x3F))
+        return out + 2
+    elif c < 0x10000:
+        out[0] = <char>(0xE0 | (c >> 12))
+        out[1] = <char>(0x80 | ((c >> 6) & 0x3F))
+        out[2] = <char>(0x80 | (c & 0x3F))
+        return out + 3
+    else:
+        out[0] = <char>(0xF0 | (c >> 18))
+        out[1] = <char>(0x80 | ((c >> 12) & 0x3F))
+        out[2] = <char>(0x80 | ((c >> 6) & 0x3F))
+        out[3] = <char>(0x80 | (c & 0x3F))
+        return out + 4
+
+
+cdef inline Py_ssize_t out_length(Py_UCS4 c, bint text) noexcept nogil:
+    """Length of a character in the output - in UTF-8 bytes, or 1 for str output"""
+    return 1 if text else utf8_length(c)
+
+
+cdef inline bint is_special(const CDialect* d, Py_UCS4 c) noexcept nogil:
+    cdef int i
+    if c < 128:
+        return d.special_ascii[c]
+    for i in range(d.special_non_ascii_count):
+        if d.special_non_ascii[i] == c:
+            return True
+    return False
+
+
+cdef FieldError measure_field(const CDialect* d, Field* f, bint text,
+                              Py_UCS4* max_char) noexcept nogil:
+    """Figures out whether the field needs quoting, and the length of its representation
+    (without the delimiter, but with the quotes) - in UTF-8 bytes, or in characters
+    if `text` is set. Then *max_char is also raised to the largest non-ASCII character
+    written, as str output has to be created with its exact kind."""
+    cdef Py_ssize_t i
+    cdef Py_UCS4 c
+    cdef bint escaped = False
+    cdef Py_ssize_t escape_length = out_length(d.escapechar, text) \
+        if d.escapechar != <Py_UCS4>NOT_SET else -1
+
+    f.plain = True
+    f.out_length = f.length if f.ascii or text else 0
+
+    for i in range(f.length):
+        c = PyUnicode_READ(f.kind, f.data, i)
+
+        if not f.ascii:
+            if text:
+                # Surrogates are written as they are, like with csv.writer
+                max_char[0] = max(max_char[0], c)
+            elif 0xD800 <= c <= 0xDFFF:
+                return FieldError.SURROGATE
+            else:
+                f.out_length += utf8_length(c)
+
+        if is_special(d, c):
+            f.plain = False
+
+            if d.quoting == WriteQuoting.NONE:
+                if escape_length < 0:
+                    return FieldError.NEED_ESCAPE
+                f.out_length += escape_length
+                escaped = True
+
+            elif c == d.quotechar:
+                if d.doublequote:
+                    f.out_length += out_length(c, text)
+                    f.quoted = True
+                elif escape_length < 0:
+                    return FieldError.NEED_ESCAPE
+                else:
+                    f.out_length += escape_length
+                    escaped = True
+
+            elif c == d.escapechar:
+                f.out_length += escape_length
+                escaped = True
+
+            else:
+                f.quoted = True
+
+    if f.quoted:
+        f.out_length += 2 * out_length(d.quotechar, text)
+
+    if text:
+        if f.quoted:
+            max_char[0] = max(max_char[0], d.quotechar)
+        if escaped:
+            max_char[0] = max(max_char[0], d.escapechar)
+
+    return FieldError.OK
+
+
+cdef char* write_field(const CDialect* d, const Field* f, char* out) noexcept nogil:
+    """Writes a field measured by measure_field to out, returning the pointer after it."""
+    cdef Py_ssize_t i
+    cdef Py_UCS4 c
+
+    if f.quoted:
+        out = put_utf8(out, d.quotechar)
+
+    if f.plain and f.ascii:
+        # Fast path - no characters require special treatment
+        if f.length:
+            memcpy(out, f.data, f.length)
+        out += f.length
+
+    else:
+        for i in range(f.length):
+            c = PyUnicode_READ(f.kind, f.data, i)
+
+            if not f.plain and is_special(d, c):
+                if d.quoting == WriteQuoting.NONE:
+                    out = put_utf8(out, d.escapechar)
+                elif c == d.quotechar:
+                    out = put_utf8(out, d.quotechar if d.doublequote else d.escapechar)
+                elif c == d.escapechar:
+                    out = put_utf8(out, d.escapechar)
+
+            out = put_utf8(out, c)
+
+    if f.quoted:
+        out = put_utf8(out, d.quotechar)
+
+    return out
+
+
+cdef FieldError measure_row(const CDialect* d, Field* fields, Py_ssize_t count,
+                            Py_ssize_t* row_length, bint text=False,
+                            Py_UCS4* max_char=NULL) noexcept nogil:
+    """Measures all fields of a row, and computes the length of the whole record
+    (including the delimiters and the line terminator). See measure_field for `text`."""
+    cdef Py_ssize_t i
+    cdef FieldError err
+    cdef Py_ssize_t length = 0
+
+    for i in range(count):
+        err = measure_field(d, &fields[i], text, max_char)
+        if err != FieldError.OK:
+            return err
+        length += fields[i].out_length
+
+    if count > 1:
+        length += (count - 1) * out_length(d.delimiter, text)
+        if text:
+            max_char[0] = max(max_char[0], d.delimiter)
+
+    # A single empty field has to be quoted, as it would be read back as an empty row
+    if count == 1 and length == 0:
+        if d.quoting == WriteQuoting.NONE:
+            return FieldError.EMPTY_RECORD
+        fields[0].quoted = True
+        fields[0].out_length = 2 * out_length(d.quotechar, text)
+        length += fields[0].out_length
+        if text:
+            max_char[0] = max(max_char[0], d.quotechar)
+
+    if text:
+        length += d.lineterminator_chars
+        max_char[0] = max(max_char[0], d.lineterminator_max)
+    else:
+        length += d.lineterminator_length
+    row_length[0] = length
+    return FieldError.OK
+
+
+cdef char* write_row(const CDialect* d, const Field* fields, Py_ssize_t count,
+                     char* out) noexcept nogil:
+    cdef Py_ssize_t i
+
+    for i in range(count):
+        if i:
+            out = put_utf8(out, d.delimiter)
+        out = write_field(d, &fields[i], out)
+
+    memcpy(out, d.lineterminator, d.lineterminator_length)
+    return out + d.lineterminator_length
+
+
+cdef Py_ssize_t write_field_text(const CDialect* d, const Field* f, int kind, void* data,
+                                 Py_ssize_t pos) noexcept nogil:
+    """Counterpart of write_field for str output, writing at data[pos].
+    Returns the position after the field."""
+    cdef Py_ssize_t i
+    cdef Py_UCS4 c
+
+    if f.quoted:
+        PyUnicode_WRITE(kind, data, pos, d.quotechar)
+        pos += 1
+
+    if f.plain and f.kind == kind:
+        # Fast path - no characters require special treatment
+        if f.length:
+            memcpy(<char*>data + pos * kind, f.data, f.length * kind)
+        pos += f.length
+
+    else:
+        for i in range(f.length):
+            c = PyUnicode_READ(f.kind, f.data, i)
+
+            if not f.plain and is_special(d, c):
+                if d.quoting == WriteQuoting.NONE:
+                    PyUnicode_WRITE(kind, data, pos, d.escapechar)
+                    pos += 1
+                elif c == d.quotechar:
+                    PyUnicode_WRITE(kind, data, pos,
+                                    d.quotechar if d.doublequote else d.escapechar)
+                    pos += 1
+                elif c == d.escapechar:
+                    PyUnicode_WRITE(kind, data, pos, d.escapechar)
+                    pos += 1
+
+            PyUnicode_WRITE(kind, data, pos, c)
+            pos += 1
+
+    if f.quoted:
+        PyUnicode_WRITE(kind, data, pos, d.quotechar)
+        pos += 1
+
+    return pos
+
+
+cdef Py_ssize_t write_row_text(const CDialect* d, const Field* fields, Py_ssize_t count,
+                               int kind, void* data, Py_ssize_t pos) noexcept nogil:
+    cdef Py_ssize_t i
+
+    for i in range(count):
+        if i:
+            PyUnicode_WRITE(kind, data, pos, d.delimiter)
+            pos += 1
+        pos = write_field_text(d, &fields[i], kind, data, pos)
+
+    for i in range(d.lineterminator_chars):
+        PyUnicode_WRITE(kind, data, pos, d.lineterminator_text[i])
+        pos += 1
+    return pos
+
+
+cdef class Serializer:
+    """Serializes CSV rows (exactly like csv.writer would) straight into UTF-8,
+    appending the data to a reusable buffer.
+
+    Only the first `used` bytes of the buffer are meaningful - see getbuffer().
+    """
+    def __init__(self, pydialect, Py_ssize_t buffer_size = MIN_BUFFER_SIZE):
+        cdef Py_UCS4 c
+        cdef Py_ssize_t i
+
+        # Bools
+        self.dialect.doublequote = <bint?>pydialect.doublequote
+
+        # Quoting
+        if pydialect.quoting == csv.QUOTE_MINIMAL:
+            self.dialect.quoting = WriteQuoting.MINIMAL
+        elif pydialect.quoting == csv.QUOTE_ALL:
+            self.dialect.quoting = WriteQuoting.ALL
+        elif pydialect.quoting == csv.QUOTE_NONNUMERIC:
+            self.dialect.quoting = WriteQuoting.NONNUMERIC
+        elif pydialect.quoting == csv.QUOTE_NONE:
+            self.dialect.quoting = WriteQuoting.NONE
+        else:
+            raise ValueError(f"unsupported quoting: {pydialect.quoting!r}")
+        self.quote_strings = self.dialect.quoting == WriteQuoting.ALL \
+            or self.dialect.quoting == WriteQuoting.NONNUMERIC
+
+        # Chars
+        self.dialect.delimiter = <Py_UCS4?>pydialect.delimiter[0]
+        self.dialect.quotechar = <Py_UCS4?>pydialect.quotechar[0] \
+            if pydialect.quotechar is not None else <Py_UCS4>NOT_SET
+        self.dialect.escapechar = <Py_UCS4?>pydialect.escapechar[0] \
+            if pydialect.escapechar is not None else <Py_UCS4>NOT_SET
+
+        self.lineterminator = (<unicode?>pydialect.lineterminator).encode("utf-8")
+        self.dialect.lineterminator = self.lineterminator
+        self.dialect.lineterminator_length = len(self.lineterminator)
+        if len(pydialect.lineterminator) > MAX_LINETERMINATOR:
+            raise ValueError("line terminator too long")
+        self.dialect.lineterminator_chars = len(pydialect.lineterminator)
+        self.dialect.lineterminator_max = 0
+        for i, c in enumerate(pydialect.lineterminator):
+            self.dialect.lineterminator_text[i] = c
+            self.dialect.lineterminator_max = max(self.dialect.lineterminator_max, c)
+
+        # Table of special characters
+        for c in range(128):
+            self.dialect.special_ascii[c] = False
+        self.dialect.special_non_ascii_count = 0
+
+        for c in pydialect.delimiter + pydialect.lineterminator \
+                + (pydialect.quotechar or "") + (pydialect.escapechar or ""):
+            if c < 128:
+                self.dialect.special_ascii[c] = True
+            elif self.dialect.special_non_ascii_count < MAX_SPECIAL_NON_ASCII:
+                self.dialect.special_non_ascii[self.dialect.special_non_ascii_count] = c
+                self.dialect.special_non_ascii_count += 1
+            else:
+                raise ValueError("too many non-ASCII special characters in the dialect")
+
+        self.buffer = bytearray(max(buffer_size, MIN_BUFFER_SIZE))
+        self.used = 0
+
+    cdef char* reserve(self, Py_ssize_t length) except NULL:
+        """Ensures that `length` bytes can be written after the used part of the buffer,
+        and returns a pointer to the first free byte."""
+        cdef Py_ssize_t capacity = PyByteArray_GET_SIZE(self.buffer)
+        cdef Py_ssize_t needed = self.used + length
+
+        if needed > capacity:
+            PyByteArray_Resize(self.buffer, max(needed, 2 * capacity))
+
+        return PyByteArray_AS_STRING(self.buffer) + self.used
+
+    cdef int prepare_field(self, object obj, Field* f, list strings) except -1:
+        """Converts a Python object into a Field. The converted string is appended to
+        `strings`, so that the data is kept alive."""
+        if self.dialect.quoting == WriteQuoting.NONNUMERIC:
+            f.quoted = not PyNumber_Check(obj)
+        else:
+            f.quoted = self.dialect.quoting == WriteQuoting.ALL
+
+        if obj is None:
+            f.data = NULL
+            f.length = 0
+            f.kind = 1
+            f.ascii = True
+            return 0
+
+        s = obj if isinstance(obj, unicode) else str(obj)
+        f.data = PyUnicode_DATA(s)
+        f.length = PyUnicode_GET_LENGTH(s)
+        f.kind = PyUnicode_KIND(s)
+        f.ascii = PyUnicode_IS_ASCII(s)
+        strings.append(s)
+        return 0
+
+    cdef int write_fields(self, Field* fields, Py_ssize_t count, list strings) except -1:
+        """Serializes a row of prepared fields, and appends it to the buffer.
+        `strings` are passed to raise_error."""
+        cdef Py_ssize_t row_length
+        cdef FieldError err = measure_row(&self.dialect, fields, count, &row_length)
+
+        if err != FieldError.OK:
+            self.raise_error(err, strings)
+
+        write_row(&self.dialect, fields, count, self.reserve(row_length))
+        self.used += row_length
+        return 0
+
+    cdef int raise_error(self, FieldError err, list strings) except -1:
+        if err == FieldError.NEED_ESCAPE:
+            raise csv.Error("need to escape, but no escapechar set")
+
+        elif err == FieldError.EMPTY_RECORD:
+            raise csv.Error("single empty field record must be quoted")
+
+        elif err == FieldError.SURROGATE:
+            # Let the built-in codec raise the appropriate UnicodeEncodeError
+            for s in strings:
+                (<unicode>s).encode("utf-8")
+            raise UnicodeEncodeError("utf-8", "", 0, 0, "surrogates not allowed")
+
+        raise RuntimeError(f"unknown serialization error: {err}")
+
+    cdef tuple row_to_tuple(self, row):
+        try:
+            return tuple(row)
+        except TypeError:
+            raise csv.Error(f"iterable expected, not {type(row).__name__}") from None
+
+    cpdef writerow(self, row):
+        """Serializes a single row and appends it to the buffer."""
+        cdef tuple values = self.row_to_tuple(row)
+        cdef Py_ssize_t count = len(values)
+        cdef Py_ssize_t i
+        cdef Field* fields = <Field*>PyMem_Malloc(max(count, 1) * sizeof(Field))
+        cdef list strings = []
+
+        if fields == NULL:
+            raise MemoryError()
+
+        try:
+            for i in range(count):
+                self.prepare_field(values[i], &fields[i], strings)
+            self.write_fields(fields, count, strings)
+
+        finally:
+            PyMem_Free(fields)
+
+    def writerows(self, rows):
+        """Serializes multiple rows and appends them to the buffer."""
+        for row in rows:
+            self.writerow(row)
+
+    def getbuffer(self):
+        """Returns a memoryview over the used part of the buffer.
+        The view has to be released before anything else is written."""
+        return memoryview(self.buffer)[:self.used]
+
+    def clear(self):
+        """Marks the whole buffer as unused, without deallocating it."""
+        self.used = 0
+
+    def dumps(self, rows, bint text=False):
+        """Serializes multiple rows into a new bytes object (or str, if `text` is set),
+        without touching the buffer. Unlike with bytes, lone surrogates can be written
+        into str, just like with csv.writer.
+
+        The GIL is only held while converting the values to strings (and allocating
+        the result), so this method can be called from multiple threads at once."""
+        cdef list tuples = [self.row_to_tuple(row) for row in rows]
+        cdef Py_ssize_t row_count = len(tuples)
+        cdef Py_ssize_t field_count = 0
+        cdef Py_ssize_t* counts = <Py_ssize_t*>PyMem_Malloc(max(row_count, 1) * sizeof(Py_ssize_t))
+        cdef Field* fields = NULL
+        cdef Field* row_fields
+        cdef list strings = []
+        cdef Py_ssize_t i, k
+        cdef Py_ssize_t total = 0
+        cdef Py_ssize_t row_length
+        cdef FieldError err = FieldError.OK
+        cdef Py_UCS4 max_char = 0
+        cdef object result
+        cdef char* out
+        cdef int kind
+        cdef void* data
+        cdef Py_ssize_t pos = 0
+
+        if counts == NULL:
+            raise MemoryError()
+
+        try:
+            for i in range(row_count):
+                counts[i] = len(<tuple>tuples[i])
+                field_count += counts[i]
+
+            fields = <Field*>PyMem_Malloc(max(field_count, 1) * sizeof(Field))
+            if fields == NULL:
+                raise MemoryError()
+
+            # Convert the values (requires the GIL)
+            k = 0
+            for i in range(row_count):
+                for value in <tuple>tuples[i]:
+                    self.prepare_field(value, &fields[k], strings)
+                    k += 1
+
+            # Measure the output
+            with nogil:
+                row_fields = fields
+                for i in range(row_count):
+                    err = measure_row(&self.dialect, row_fields, counts[i], &row_length, text,
+                                      &max_char)
+                    if err != FieldError.OK:
+                        break
+                    total += row_length
+                    row_fields += counts[i]
+
+            if err != FieldError.OK:
+                self.raise_error(err, strings)
+
+            # Write the output
+            if text:
+                result = PyUnicode_New(total, max_char)
+                kind = PyUnicode_KIND(result)
+                data = PyUnicode_DATA(result)
+                with nogil:
+                    row_fields = fields
+                    for i in range(row_count):
+                        pos = write_row_text(&self.dialect, row_fields, counts[i], kind, data,
+                                             pos)
+                        row_fields += counts[i]
+                return result
+
+            result = PyBytes_FromStringAndSize(NULL, total)
+            out = PyBytes_AS_STRING(result)
+
+            with nogil:
+                row_fields = fields
+                for i in range(row_count):
+                    out = write_row(&self.dialect, row_fields, counts[i], out)
+                    row_fields += counts[i]
+
+            return result
+
+        finally:
+            PyMem_Free(counts)
+            PyMem_Free(fields)
@@ -0,0 +1,137 @@
+import csv
+from typing import Any, Dict, List, Mapping, Optional, Sequence, Tuple
+
+from .dialects import DialectLike, resolve_dialect
+from .extensions import optional_extension
+from .protocols import WithAsyncRead
+from .readers import AsyncReader
+
+AGGREGATE_FUNCTIONS = ("count", "sum", "min", "max", "mean")
+
+# Name of an aggregate -> (function, column); the column of "count" is ignored
+Aggregates = Mapping[str, Tuple[str, Optional[int]]]
+
+
+class _Accumulator:
+    """Fallback counterpart of Aggregator's accumulators - sums are compensated
+    the same way, see Accumulator in _parser.pyx"""
+    __slots__ = ("value", "compensation", "count")
+
+    def __init__(self) -> None:
+        self.value = 0.0
+        self.compensation = 0.0
+        self.count = 0
+
+    def add(self, function: str, number: float) -> None:
+        if function == "min":
+            if not self.count or number < self.value:
+                self.value = number
+        elif function == "max":
+            if not self.count or number > self.value:
+                self.value = number
+        else:
+            total = self.value + number
+            if abs(self.value) >= abs(number):
+                self.compensation += (self.value - total) + number
+            else:
+                self.compensation += (number - total) + self.value
+            self.value = total
+        self.count += 1
+
+    def result(self, function: str) -> Any:
+        if function == "count":
+            return self.count
+        elif function == "sum":
+            return self.value + self.compensation
+        elif not self.count:
+            return None
+        elif function == "mean":
+            return (self.value + self.compensation) / self.count
+        return self.value
+
+
+async def _aggregate_rows(src: WithAsyncRead, key_columns: Sequence[int],
+                          aggregates: List[Tuple[str, Optional[int]]], header: bool,
+                          dialect: csv.Dialect) -> List[Tuple[Tuple[Any, ...], List[Any]]]:
+    """Fallback for aggregate, without the C extension"""
+    groups: Dict[Tuple[Any, ...], List[_Accumulator]] = {}
+    first = True
+
+    async for row in AsyncReader(src, dialect=dialect):
+        if header and first:
+            first = False
+            continue
+        first = False
+        if not row:
+            continue
+
+        key = tuple(row[i] if i < len(row) else "" for i in key_columns)
+        accumulators = groups.get(key)
+        if accumulators is None:
+            accumulators = groups[key] = [_Accumulator() for _ in aggregates]
+
+        for (function, column), acc in zip(aggregates, accumulators):
+            if function == "count":
+                acc.count += 1
+            elif column is not None and column < len(row) and row[column] != "":
+                acc.add(function, float(row[column]))
+
+    return [(key, [acc.result(function) for (function, _), acc in zip(aggregates, accs)])
+            for key, accs in groups.items()]
+
+
+async def _aggregate_indexed(src: WithAsyncRead, key_columns: Sequence[int],
+                             aggregates: List[Tuple[str, Optional[int]]], header: bool,
+                             dialect: csv.Dialect) -> List[Tuple[Tuple[Any, ...], List[Any]]]:
+    aggregator = Aggregator(key_columns, aggregates)
+    first_row = 1 if header else 0
+
+    async for index in index_chunks(src, dialect):
+        aggregator.update(index, first_row)
+        first_row = max(0, first_row - len(index))
+
+    return aggregator.result()
+
+
+async def aggregate(src: WithAsyncRead, key_columns: Sequence[int], aggregates: Aggregates, *,
+                    header: bool = False,
+                    dialect: DialectLike = "excel") -> Dict[Tuple[Any, ...], Dict[str, Any]]:
+    """Groups CSV rows from `src` by the fields at `key_columns`, and computes `aggregates`
+    of every group. Returns a dict mapping key tuples (in order of appearance) to dicts
+    with the result of every aggregate.
+
+    `aggregates` maps names to (function, column) pairs. Functions are "count"
+    (rows in the group, the column is ignored), "sum", "min", "max" and "mean"
+    (floats of fields at the column; None for "min", "max" and "mean" of a group
+    without any values). Empty fields are skipped; other non-numbers raise ValueError.
+    Missing key fields are empty strings; empty rows are skipped,
+    and so is the first row if `header` is set.
+
+    With the C extension, rows are never converted into Python objects: keys are hashed
+    straight from the input, and numbers are converted in C.
+    """
+    reader_dialect = resolve_dialect(dialect)
+
+    key_columns = list(key_columns)
+    if any(i < 0 for i in key_columns):
+        raise ValueError("key column indices can't be negative")
+
+    functions = list(aggregates.items())
+    for name, (function, column) in functions:
+        if function not in AGGREGATE_FUNCTIONS:
+            raise ValueError(f"unknown aggregate function of {name!r}: {function!r}")
+        if function != "count" and (column is None or column < 0):
+            raise ValueError(f"{function} of {name!r} requires a non-negative column index")
+    specs = [spec for _, spec in functions]
+
+    # QUOTE_NONNUMERIC keys are floats, which can only be compared as Python objects
+    if Aggregator is not None and reader_dialect.quoting != csv.QUOTE_NONNUMERIC:
+        groups = await _aggregate_indexed(src, key_columns, specs, header, reader_dialect)
+    else:
+        groups = await _aggregate_rows(src, key_columns, specs, header, reader_dialect)
+
+    return {key: {name: value for (name, _), value in zip(functions, values)}
+            for key, values in groups}
+
+
+Aggregator, index_chunks = optional_extension("_parser", "Aggregator", "index_chunks")
@@ -0,0 +1,222 @@
+import asyncio
+import csv
+import hashlib
+import json
+import mmap
+import os
+import shutil
+import struct
+import sys
+import tempfile
+from typing import IO, Any, AsyncIterator, Dict, List, Optional
+
+from .extensions import optional_extension
+from .protocols import WithAsyncRead
+from .streams import ExecutorFile
+
+# Bumped whenever the layout of cache files changes
+CACHE_FORMAT_VERSION: int = 2
+
+CACHE_MAGIC = b"AIOCSVC\x01"
+
+# Minimal amount of characters indexed (and dumped into the cache) at once
+CACHE_CHUNK: int = 1 << 18
+
+# Rows decoded from the cache at once
+CACHE_BATCH: int = 1024
+
+# heap_start, heap_len, rows_start, rows_len, fields_len, CACHE_MAGIC
+_TRAILER = struct.Struct("<qqqqq8s")
+_HEADER_LENGTH = struct.Struct("<I")
+
+
+def cache_key(path: str, stat: os.stat_result, dialect: csv.Dialect,
+              encoding: str) -> Dict[str, Any]:
+    """Everything that has to match for a cache file to be used"""
+    return {
+        "version": CACHE_FORMAT_VERSION,
+        "byteorder": sys.byteorder,
+        "path": os.path.abspath(path),
+        "file": list(_file_version(stat)),
+        "encoding": encoding,
+        "dialect": {
+            "delimiter": dialect.delimiter,
+            "quotechar": dialect.quotechar,
+            "escapechar": dialect.escapechar,
+            "doublequote": dialect.doublequote,
+            "skipinitialspace": dialect.skipinitialspace,
+            "quoting": int(dialect.quoting),
+            "strict": dialect.strict,
+        },
+    }
+
+
+def _file_version(stat: os.stat_result) -> Any:
+    """Fields of a stat result which change when the file is modified or replaced
+    (not st_atime, updated by reading the file)"""
+    return stat.st_size, stat.st_mtime_ns, stat.st_ino, stat.st_dev
+
+
+def _encode_key(key: Dict[str, Any]) -> bytes:
+    return json.dumps(key, sort_keys=True).encode("utf-8")
+
+
+def cache_file_name(key: Dict[str, Any]) -> str:
+    """Name of the cache file for the given key. The version of the file isn't part of it,
+    so caching a modified file replaces the stale cache file (the whole key, stored
+    in the header of a cache file, is still checked before it's used)."""
+    unversioned = {k: v for k, v in key.items() if k != "file"}
+    return hashlib.sha256(_encode_key(unversioned)).hexdigest() + ".csvcache"
+
+
+def _open_cache(path: str, key: bytes) -> Optional[Any]:
+    """Memory-maps a cache file. Returns None if it doesn't exist or doesn't match the key."""
+    try:
+        with open(path, "rb") as f:
+            if os.fstat(f.fileno()).st_size < len(CACHE_MAGIC) + _TRAILER.size:
+                return None
+            buffer = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    except FileNotFoundError:
+        return None
+
+    try:
+        header_end = len(CACHE_MAGIC) + _HEADER_LENGTH.size
+        if buffer[:len(CACHE_MAGIC)] != CACHE_MAGIC:
+            raise ValueError("not a cache file")
+        key_length, = _HEADER_LENGTH.unpack_from(buffer, len(CACHE_MAGIC))
+        if buffer[header_end:header_end + key_length] != key:
+            raise ValueError("cache file of something else")
+
+        *layout, magic = _TRAILER.unpack_from(buffer, len(buffer) - _TRAILER.size)
+        if magic != CACHE_MAGIC:
+            raise ValueError("incomplete cache file")
+        return CachedRows(buffer, *layout)
+
+    except ValueError:
+        buffer.close()
+        return None
+
+
+class _CacheWriter:
+    """Writes a cache file, chunk by chunk. Tables are collected in separate temporary files,
+    and appended to the heap once everything is dumped. Runs on an executor."""
+
+    def __init__(self, directory: str, key: bytes) -> None:
+        os.makedirs(directory, exist_ok=True)
+        self.file: IO[bytes] = tempfile.NamedTemporaryFile(dir=directory, prefix=".",
+                                                           suffix=".tmp", delete=False)
+        self.tables: List[IO[bytes]] = [tempfile.TemporaryFile(dir=directory) for _ in range(3)]
+        self.file.write(CACHE_MAGIC + _HEADER_LENGTH.pack(len(key)) + key)
+        self.heap_start = self.file.tell()
+        self.heap_len = 0
+        self.rows_len = 0
+        self.fields_len = 0
+
+    def add(self, index: Any) -> None:
+        heap, row_ends, field_ends, flags = dump_index(index, self.fields_len, self.heap_len)
+        self.file.write(heap)
+        for table, data in zip(self.tables, (row_ends, field_ends, flags)):
+            table.write(data)
+        self.heap_len += len(heap)
+        self.rows_len += len(index)
+        self.fields_len += len(flags)
+
+    def commit(self, path: str) -> None:
+        """Finishes the cache file, and atomically moves it to `path`,
+        replacing the cache of an older version of the file."""
+        self.file.write(b"\0" * (-self.file.tell() % 8))
+        rows_start = self.file.tell()
+        for table in self.tables:
+            table.seek(0)
+            shutil.copyfileobj(table, self.file)
+        self.file.write(_TRAILER.pack(self.heap_start, self.heap_len, rows_start, self.rows_len,
+                                      self.fields_len, CACHE_MAGIC))
+        self.close()
+        try:
+            os.replace(self.file.name, path)
+        except PermissionError:
+            # On Windows, the stale cache file can't be replaced while it's memory-mapped
+            # by another reader; it'll be replaced by the next cold start
+            self.abort()
+
+    def close(self) -> None:
+        self.file.close()
+        for table in self.tables:
+            table.close()
+
+    def abort(self) -> None:
+        self.close()
+        try:
+            os.unlink(self.file.name)
+        except FileNotFoundError:
+            pass
+
+
+def _close_cache(cached: Any, buffer: mmap.mmap) -> None:
+    cached.release()
+    try:
+        buffer.close()
+    except BufferError:
+        # Views of the cache are still used, the mmap is closed once they're gone
+        pass
+
+
+async def cached_parser(file: ExecutorFile, dialect: csv.Dialect, cache_dir: str,
+                        views: bool = False, progress: Any = None,
+                        source: Optional[WithAsyncRead] = None) -> AsyncIterator[List[Any]]:
+    """Yields rows of the CSV `file`, from a cache file in `cache_dir` if there's one
+    for the current version of the file; otherwise the file is parsed (read through `source`,
+    e.g. a ReadMeter wrapping it, if given), and the cache is written along the way.
+    File operations run on the executor of `file`."""
+    path, encoding, executor = file.path, file.encoding, file.executor
+    loop = asyncio.get_event_loop()
+    stat = await loop.run_in_executor(executor, os.stat, path)
+    key = cache_key(path, stat, dialect, encoding)
+    cache_path = os.path.join(cache_dir, cache_file_name(key))
+    encoded_key = _encode_key(key)
+
+    # 1. Warm start: rows are decoded straight from the memory-mapped cache
+    cached = await loop.run_in_executor(executor, _open_cache, cache_path, encoded_key)
+    if cached is not None:
+        buffer = cached.obj
+        try:
+            for start in range(0, len(cached), CACHE_BATCH):
+                for row in cached.materialize(start, start + CACHE_BATCH, views):
+                    if progress is not None:
+                        progress.rows += 1
+                    yield row
+        finally:
+            _close_cache(cached, buffer)
+        if progress is not None:
+            await progress.report()
+        return
+
+    # 2. Cold start: the file is parsed, and every chunk is dumped into the cache
+    writer = await loop.run_in_executor(executor, _CacheWriter, cache_dir, encoded_key)
+    committed = False
+    try:
+        async for index in index_chunks(source or file, dialect, progress=progress,
+                                        min_chunk=CACHE_CHUNK):
+            await loop.run_in_executor(executor, writer.add, index)
+            for row in (index.view_rows() if views else index.materialize()):
+                if progress is not None:
+                    progress.rows += 1
+                yield row
+
+        # A file modified while it was read could've been cached half-old, half-new
+        new_stat = await loop.run_in_executor(executor, os.stat, path)
+        if _file_version(new_stat) == _file_version(stat):
+            await loop.run_in_executor(executor, writer.commit, cache_path)
+            committed = True
+
+    finally:
+        file.close()
+        if not committed:
+            writer.abort()
+
+    if progress is not None:
+        await progress.report()
+
+
+CachedRows, dump_index, index_chunks = optional_extension("_parser", "CachedRows",
+                                                          "dump_index", "index_chunks")
@@ -0,0 +1,14 @@
+from typing import Any, Union
+import csv
+
+DialectLike = Union[str, csv.Dialect, type]
+
+
+def resolve_dialect(dialect: DialectLike = "excel", **params: Any) -> csv.Dialect:
+    """Returns the dialect used by csv.reader(…, dialect, **params) or csv.writer(…).
+    Without extra parameters, a dialect name resolves to the registered dialect itself -
+    without creating a reader or a new dialect."""
+    if not params and isinstance(dialect, str):
+        return csv.get_dialect(dialect)
+    # Keyword arguments are parsed faster by csv.reader than by the Dialect constructor
+    return csv.reader("", dialect, **params).dialect
@@ -0,0 +1,12 @@
+from importlib import import_module
+from typing import Any, Tuple
+
+
+def optional_extension(module: str, *names: str) -> Tuple[Any, ...]:
+    """Returns the named objects of one of aiocsv's C extensions (e.g. "_parser"),
+    or Nones if it isn't compiled - callers then use their pure-Python paths."""
+    try:
+        extension = import_module(f".{module}", __package__)
+    except ImportError:
+        return (None,) * len(names)
+    return tuple(getattr(extension, name) for name in names)
@@ -0,0 +1,139 @@
+import time
+from typing import Any, Dict, Iterable, Iterator, Optional, TypeVar, Union
+
+from .protocols import WithAsyncRead, WithAsyncWrite, WithAsyncWriteBytes
+
+T = TypeVar("T")
+Attributes = Dict[str, Any]
+
+
+class Span:
+    """A timed operation. The no-op base class can be used as a context manager,
+    which ends the span on exit."""
+    def set_attribute(self, key: str, value: Any) -> None:
+        pass
+
+    def end(self, error: Optional[BaseException] = None) -> None:
+        pass
+
+    def __enter__(self) -> "Span":
+        return self
+
+    def __exit__(self, _: Any, exc: Optional[BaseException], __: Any) -> None:
+        self.end(exc)
+
+
+class Instrumentation:
+    """Receives spans and metrics from readers and writers.
+
+    All methods are no-ops - subclass it and override them to forward data
+    to a tracing/metrics library (e.g. OpenTelemetry).
+    """
+    def start_span(self, name: str, attributes: Optional[Attributes] = None) -> Span:
+        """Starts a span; it's ended by calling its `end` method."""
+        return _NOOP_SPAN
+
+    def add(self, name: str, value: Union[int, float],
+            attributes: Optional[Attributes] = None) -> None:
+        """Adds a value to a counter."""
+        pass
+
+    def record(self, name: str, value: Union[int, float],
+               attributes: Optional[Attributes] = None) -> None:
+        """Records a value in a histogram."""
+        pass
+
+
+_NOOP_SPAN = Span()
+_default: Optional[Instrumentation] = None
+
+
+def set_default(instrumentation: Optional[Instrumentation]) -> None:
+    """Sets the Instrumentation used by readers and writers created without
+    an explicit `instrumentation` argument. None restores the no-op default."""
+    global _default
+    _default = instrumentation
+
+
+def get_default() -> Optional[Instrumentation]:
+    return _default
+
+
+class ReadMeter:
+    """WithAsyncRead wrapper, which reports reads from the file and rows parsed from it.
+
+    The "aiocsv.read" span covers the whole file, from the first read (or row, for readers
+    of cache files, which don't read the file) to the end of the file (or an error)."""
+    def __init__(self, instrumentation: Instrumentation, asyncfile: WithAsyncRead,
+                 attributes: Attributes) -> None:
+        self.instrumentation = instrumentation
+        self.file = asyncfile
+        self.attributes = attributes
+        self.span: Optional[Span] = None
+        self.chars = 0
+        self.rows = 0
+        self.unreported_rows = 0
+
+    def start(self) -> None:
+        if self.span is None:
+            self.span = self.instrumentation.start_span("aiocsv.read", self.attributes)
+
+    async def read(self, size: int) -> str:
+        self.start()
+        start = time.perf_counter()
+        data = await self.file.read(size)
+        self.instrumentation.record("aiocsv.read.duration", time.perf_counter() - start,
+                                    self.attributes)
+        self.instrumentation.add("aiocsv.chars_read", len(data), self.attributes)
+        self.chars += len(data)
+        self.flush_rows()
+        return data
+
+    def add_rows(self, rows: int) -> None:
+        self.start()
+        self.rows += rows
+        self.unreported_rows += rows
+
+    def flush_rows(self) -> None:
+        if self.unreported_rows:
+            self.instrumentation.add("aiocsv.rows_read", self.unreported_rows, self.attributes)
+            self.unreported_rows = 0
+
+    def finish(self, error: Optional[BaseException] = None) -> None:
+        self.flush_rows()
+        if self.span is not None:
+            self.span.set_attribute("aiocsv.rows", self.rows)
+            self.span.set_attribute("aiocsv.chars", self.chars)
+            self.span.end(error)
+            self.span = None
+
+
+class WriteMeter:
+    """Reports every write to the file in an "aiocsv.write" span, together
+    with the number of rows written and the write latency."""
+    def __init__(self, instrumentation: Instrumentation, attributes: Attributes) -> None:
+        self.instrumentation = instrumentation
+        self.attributes = attributes
+        self.rows = 0
+
+    def count(self, rows: Iterable[T]) -> Iterator[T]:
+        for row in rows:
+            self.rows += 1
+            yield row
+
+    async def write(self, asyncfile: Union[WithAsyncWrite, WithAsyncWriteBytes],
+                    data: Any) -> None:
+        unit = "chars" if isinstance(data, str) else "bytes"
+        rows, self.rows = self.rows, 0
+
+        with self.instrumentation.start_span("aiocsv.write", self.attributes) as span:
+            span.set_attribute("aiocsv.rows", rows)
+            span.set_attribute(f"aiocsv.{unit}", len(data))
+
+            start = time.perf_counter()
+            await asyncfile.write(data)
+            self.instrumentation.record("aiocsv.write.duration", time.perf_counter() - start,
+                                        self.attributes)
+
+        self.instrumentation.add("aiocsv.rows_written", rows, self.attributes)
+        self.instrumentation.add(f"aiocsv.{unit}_written", len(data), self.attributes)
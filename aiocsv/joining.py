@@ -0,0 +1,176 @@
+import csv
+from typing import Any, Dict, List, Optional, Sequence, Union
+
+from .dialects import DialectLike, resolve_dialect
+from .extensions import optional_extension
+from .pipeline import TRANSFORM_BATCH_SIZE, TRANSFORM_BUFFER_SIZE, _flush_serializer
+from .protocols import WithAsyncRead, WithAsyncWrite, WithAsyncWriteBytes
+from .readers import AsyncReader
+from .serializer import make_serializer
+from .writers import AsyncWriter
+
+
+class RowTable:
+    """Fallback for JoinTable (without the C extension, or for QUOTE_NONNUMERIC dialects):
+    a dict of key tuples to lists of the selected fields."""
+
+    def __init__(self, key_columns: Sequence[int], columns: Sequence[int]) -> None:
+        self.key_columns = list(key_columns)
+        self.columns = list(columns)
+        self.keys_len = len(self.key_columns)
+        self.width = len(self.columns)
+        self.header: Optional[List[Any]] = None
+        self.rows: Dict[Any, List[Any]] = {}
+
+    def __len__(self) -> int:
+        return len(self.rows)
+
+    def add_row(self, row: List[Any]) -> None:
+        if row:
+            key = tuple(row[i] if i < len(row) else "" for i in self.key_columns)
+            if key not in self.rows:
+                self.rows[key] = [row[i] if i < len(row) else "" for i in self.columns]
+
+    def get(self, key: Sequence[Any]) -> Optional[List[Any]]:
+        return self.rows.get(tuple(key))
+
+
+LookupTable = Union["JoinTable", RowTable]
+
+
+def _check_columns(columns: Sequence[int], what: str) -> List[int]:
+    columns = list(columns)
+    if any(i < 0 for i in columns):
+        raise ValueError(f"{what} indices can't be negative")
+    return columns
+
+
+async def load_table(src: WithAsyncRead, key_columns: Sequence[int], columns: Sequence[int], *,
+                     header: bool = False, dialect: DialectLike = "excel") -> LookupTable:
+    """Reads CSV rows from `src` into a lookup table for `join`, keeping only the fields
+    at `key_columns` and `columns`. The first row with a given key wins; empty rows
+    are skipped, missing fields are empty strings. If `header` is set, the selected fields
+    of the first row are kept as the `header` attribute of the table.
+
+    With the C extension, the fields are packed into a single buffer, and indexed
+    by a hash table of their keys - without creating any Python objects.
+    `table.get(key)` returns the selected fields of the row with a key (a tuple of str).
+    """
+    reader_dialect = resolve_dialect(dialect)
+    key_columns = _check_columns(key_columns, "key column")
+    columns = _check_columns(columns, "column")
+
+    if JoinTable is None or reader_dialect.quoting == csv.QUOTE_NONNUMERIC:
+        table = RowTable(key_columns, columns)
+        async for row in AsyncReader(src, dialect=reader_dialect):
+            if header and table.header is None:
+                table.header = [row[i] if i < len(row) else "" for i in columns]
+            else:
+                table.add_row(row)
+        return table
+
+    join_table = JoinTable(key_columns, columns)
+    first_row = 1 if header else 0
+    async for index in index_chunks(src, reader_dialect):
+        if first_row and len(index):
+            row = index.materialize(columns, rows=[0])[0]
+            join_table.header = row or [""] * len(columns)
+        join_table.add(index, first_row)
+        first_row = max(0, first_row - len(index))
+    return join_table
+
+
+async def _join_indexed(src: WithAsyncRead, dst: Any, table: "JoinTable",
+                        key_columns: List[int], inner: bool, header: bool,
+                        dialect_in: csv.Dialect, serializer: Any, binary: bool) -> int:
+    rows = 0
+    first_row = 1 if header else 0
+    try:
+        async for index in index_chunks(src, dialect_in):
+            if first_row and len(index):
+                serializer.writerow(index.materialize(rows=[0])[0] + _header_values(table))
+                rows += 1
+            rows += table.join(index, serializer, key_columns, inner, first_row)
+            first_row = max(0, first_row - len(index))
+            if serializer.used >= TRANSFORM_BUFFER_SIZE:
+                await _flush_serializer(serializer, dst, binary)
+
+    finally:
+        if serializer.used:
+            await _flush_serializer(serializer, dst, binary)
+
+    return rows
+
+
+async def _join_rows(src: WithAsyncRead, dst: Any, table: LookupTable, key_columns: List[int],
+                     inner: bool, header: bool, dialect_in: csv.Dialect,
+                     dialect_out: csv.Dialect, binary: bool) -> int:
+    """Fallback for join, without the C extensions"""
+    writer = AsyncWriter(dst, binary=binary, dialect=dialect_out)
+    missing = [""] * table.width
+    # JoinTable only has str keys - QUOTE_NONNUMERIC numbers are looked up as str(number)
+    str_keys = not isinstance(table, RowTable)
+    batch: List[List[Any]] = []
+    rows = 0
+    first = True
+
+    try:
+        async for row in AsyncReader(src, dialect=dialect_in):
+            if header and first:
+                batch.append(row + _header_values(table))
+            elif row:
+                key = [row[i] if i < len(row) else "" for i in key_columns]
+                values = table.get([str(k) for k in key] if str_keys else key)
+                if values is not None or not inner:
+                    batch.append(row + (missing if values is None else values))
+            first = False
+
+            if len(batch) >= TRANSFORM_BATCH_SIZE:
+                full, batch = batch, []
+                await writer.writerows(full)
+                rows += len(full)
+
+    finally:
+        if batch:
+            await writer.writerows(batch)
+            rows += len(batch)
+
+    return rows
+
+
+def _header_values(table: LookupTable) -> List[Any]:
+    return list(table.header) if table.header is not None else [""] * table.width
+
+
+async def join(src: WithAsyncRead, dst: Union[WithAsyncWrite, WithAsyncWriteBytes],
+               table: LookupTable, key_columns: Sequence[int], *, inner: bool = False,
+               header: bool = False, dialect_in: DialectLike = "excel",
+               dialect_out: DialectLike = "excel", binary: bool = False) -> int:
+    """Copies CSV rows from `src` to `dst` (like transform), appending the fields
+    of the row of `table` (see load_table) with the same key as the fields at `key_columns`.
+    Rows without a match get empty strings instead - or are skipped, if `inner` is set.
+    Empty rows are skipped. If `header` is set, the first row gets the header of the table.
+    Returns the number of written rows.
+
+    With the C extensions, nothing is converted into Python objects: keys are hashed
+    straight from the input, and all fields are copied straight into the output buffer.
+    """
+    reader_dialect = resolve_dialect(dialect_in)
+    writer_dialect = resolve_dialect(dialect_out)
+    key_columns = _check_columns(key_columns, "key column")
+    if len(key_columns) != table.keys_len:
+        raise ValueError(f"the table has keys of {table.keys_len} fields, "
+                         f"got {len(key_columns)} key columns")
+
+    serializer = make_serializer(writer_dialect)
+    if JoinTable is not None and isinstance(table, JoinTable) \
+            and isinstance(serializer, FastSerializer) \
+            and reader_dialect.quoting != csv.QUOTE_NONNUMERIC:
+        return await _join_indexed(src, dst, table, key_columns, inner, header, reader_dialect,
+                                   serializer, binary)
+    return await _join_rows(src, dst, table, key_columns, inner, header, reader_dialect,
+                            writer_dialect, binary)
+
+
+JoinTable, index_chunks = optional_extension("_parser", "JoinTable", "index_chunks")
+FastSerializer, = optional_extension("_serializer", "Serializer")
@@ -0,0 +1,153 @@
+import asyncio
+import csv
+import io
+import os
+from concurrent.futures import Executor, ThreadPoolExecutor
+from typing import Any, List, Optional, Sequence, Union
+
+from .dialects import resolve_dialect
+from .extensions import optional_extension
+
+# Buffers shorter than this (per worker) aren't split into segments
+PARALLEL_MIN_SEGMENT: int = 1 << 20
+
+BufferLike = Union[str, bytes, bytearray, memoryview, Any]
+
+
+class _MemoryReader:
+    """Minimal WithAsyncRead over an in-memory string"""
+    def __init__(self, text: str) -> None:
+        self._text = io.StringIO(text, newline="")
+
+    async def read(self, size: int = -1) -> str:
+        return self._text.read(size)
+
+
+async def _parse_fallback(buffer: BufferLike, encoding: str, dialect: csv.Dialect,
+                          views: bool) -> List[Sequence[Any]]:
+    text = buffer if isinstance(buffer, str) else str(buffer, encoding)
+    rows = [row async for row in parser(_MemoryReader(text), dialect)]
+    if views:
+        return [[str(cell).encode("utf-8") for cell in row] for row in rows]
+    return rows
+
+
+async def _split_points(source: Any, dialect: csv.Dialect, segments: int,
+                        executor: Executor) -> List[int]:
+    """Returns positions, at which the source is expected to start a new row."""
+    loop = asyncio.get_event_loop()
+    length = source.length
+    starts = [length * i // segments for i in range(segments + 1)]
+    quotechar = dialect.quotechar if dialect.quotechar and dialect.quoting != csv.QUOTE_NONE \
+        else None
+
+    # 1. Count quotes in every segment, to know whether the next one starts inside quotes
+    parity = [False] * segments
+    if quotechar is not None:
+        counts = await asyncio.gather(*(
+            loop.run_in_executor(executor, source.count_quotes, starts[i], starts[i + 1],
+                                 quotechar)
+            for i in range(segments - 1)
+        ))
+        for i, count in enumerate(counts, start=1):
+            parity[i] = parity[i - 1] ^ bool(count & 1)
+
+    # 2. Find the first line break outside of quotes in every segment
+    found = await asyncio.gather(*(
+        loop.run_in_executor(executor, source.find_row_start, starts[i], starts[i + 1],
+                             quotechar, parity[i])
+        for i in range(1, segments)
+    ))
+
+    return [0] + sorted({i for i in found if i > 0}) + [length]
+
+
+def _stitch(indices: List[Any], bounds: List[int]) -> Any:
+    """Merges indices of consecutive segments. If a segment wasn't split at
+    an actual row boundary, it's indexed again, continuing from the previous segment."""
+    merged = indices[0]
+    for i in range(1, len(indices)):
+        if merged.at_row_boundary:
+            merged.absorb(indices[i])
+        else:
+            merged.index(bounds[i], bounds[i + 1])
+    merged.finish()
+    return merged
+
+
+def _index_segment(source: Any, dialect: csv.Dialect, start: int, end: int) -> Any:
+    index = BufferIndex(source, dialect)
+    index.index(start, end)
+    return index
+
+
+async def parse_buffer(buffer: BufferLike, *, workers: Optional[int] = None,
+                       encoding: str = "utf-8", executor: Optional[Executor] = None,
+                       lazy: bool = False, views: bool = False,
+                       **csvreaderparams) -> List[Sequence[Any]]:
+    """Parses a whole in-memory CSV file (a str, bytes, bytearray, memoryview or mmap)
+    on multiple threads, returning a list of all rows.
+
+    If `lazy` is set, rows are returned as read-only sequences, which only create
+    values of the fields that are actually accessed. The buffer has to stay
+    unmodified while the rows are used.
+
+    If `views` is set, rows are lists of bytes-like objects. Fields without quotes and escapes
+    in UTF-8 buffers are returned as memoryviews of the buffer, without copying - so
+    the buffer stays pinned while any returned field is alive: it can't be resized,
+    and closing an mmap raises BufferError.
+
+    Additional keyword arguments are understood as dialect parameters.
+    """
+    dialect = resolve_dialect(**csvreaderparams)
+
+    if BufferIndex is None:
+        return await _parse_fallback(buffer, encoding, dialect, views)
+
+    source = Source(buffer, encoding, dialect)
+    # Lazy rows read straight from the buffer
+    release_source = not lazy
+
+    loop = asyncio.get_event_loop()
+    workers = workers or os.cpu_count() or 1
+    own_executor = executor is None
+    executor = executor or ThreadPoolExecutor(workers, "aiocsv-parser")
+
+    try:
+        segments = max(1, min(workers, source.length // PARALLEL_MIN_SEGMENT))
+
+        if segments > 1:
+            bounds = await _split_points(source, dialect, segments, executor)
+        else:
+            bounds = [0, source.length]
+
+        # Speculatively index every segment, as if it started a new row
+        indices = await asyncio.gather(*(
+            loop.run_in_executor(executor, _index_segment, source, dialect,
+                                 bounds[i], bounds[i + 1])
+            for i in range(len(bounds) - 1)
+        ))
+
+        merged = await loop.run_in_executor(executor, _stitch, indices, bounds)
+
+        if lazy:
+            merged.check_error()
+            return merged.lazy_rows()
+        elif views:
+            merged.check_error()
+            return merged.view_rows()
+        else:
+            return await loop.run_in_executor(executor, merged.materialize)
+
+    finally:
+        # Drop the source's own export of the buffer - memoryviews returned with `views`
+        # still keep it exported, but other results don't refer to the buffer at all
+        if release_source:
+            source.release()
+        if own_executor:
+            executor.shutdown(wait=False)
+
+
+BufferIndex, Source = optional_extension("_parser", "BufferIndex", "Source")
+if BufferIndex is None:
+    from .parser import parser
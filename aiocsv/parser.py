@@ -1,6 +1,8 @@
+import collections.abc
 import enum
 import csv
-from typing import AsyncIterator, List
+import time
+from typing import Any, AsyncGenerator, Callable, Dict, List, Optional, Union
 
 from .protocols import WithAsyncRead
 
@@ -19,17 +21,131 @@ class ParserState(enum.Enum):
     EAT_NEWLINE = enum.auto()
 
 
-async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[List[str]]:
+class Progress:
+    """Calls on_progress(chars_read, rows) every `every` characters, and at the end of the file.
+    The callback may be a coroutine function."""
+    def __init__(self, on_progress: Callable[[int, int], Any], every: int) -> None:
+        self.on_progress = on_progress
+        self.every = max(every, 1)
+        self.next_report = self.every
+        self.chars = 0
+        self.rows = 0
+
+    def due(self, chars: int) -> bool:
+        """Records that `chars` more characters were read,
+        and returns True if the callback should be called."""
+        self.chars += chars
+        return self.chars >= self.next_report
+
+    async def report(self) -> None:
+        self.next_report = self.chars + self.every
+        result = self.on_progress(self.chars, self.rows)
+        # Not inspect.isawaitable, as importing inspect takes longer than the whole module
+        if isinstance(result, collections.abc.Awaitable):
+            await result
+
+
+class Profile:
+    """Attributes characters and time spent by the parser to its states,
+    reads from the file, the consumer of rows and float conversions. See report()."""
+    def __init__(self) -> None:
+        names = [i.name for i in ParserState] + ["read", "consumer", "float"]
+        self.chars: Dict[str, int] = dict.fromkeys(names, 0)
+        self.count: Dict[str, int] = dict.fromkeys(names, 0)
+        self.seconds: Dict[str, float] = dict.fromkeys(names, 0.0)
+        self.current = ParserState.AFTER_DELIM.name
+        self.since = time.perf_counter()
+
+    def charge(self, bucket: str) -> None:
+        """Adds the time since the last charge to the bucket."""
+        now = time.perf_counter()
+        self.seconds[bucket] += now - self.since
+        self.since = now
+
+    def step(self, state: ParserState) -> None:
+        """Records that a single char is processed in the given state."""
+        self.chars[state.name] += 1
+        if state.name != self.current:
+            self.charge(self.current)
+            self.current = state.name
+            self.count[state.name] += 1
+
+    def read(self, chars: int) -> None:
+        """Called right after a read of `chars` characters."""
+        self.charge("read")
+        self.count["read"] += 1
+        self.chars["read"] += chars
+
+    def resumed(self) -> None:
+        """Called right after the consumer asks for the next row."""
+        self.charge("consumer")
+        self.count["consumer"] += 1
+
+    def to_float(self, cell: str) -> float:
+        self.charge(self.current)
+        value = float(cell)
+        self.charge("float")
+        self.count["float"] += 1
+        self.chars["float"] += len(cell)
+        return value
+
+    def report(self) -> Dict[str, Dict[str, Union[int, float]]]:
+        """Returns a dict mapping bucket names to dicts with "chars", "count" and "seconds".
+
+        Buckets named after parser states count the chars processed in that state,
+        and how many times the parser entered it. "read" counts reads from the file,
+        "consumer" counts rows (with the time spent outside the parser), and "float"
+        counts QUOTE_NONNUMERIC conversions."""
+        return {
+            name: {"chars": self.chars[name], "count": self.count[name],
+                   "seconds": self.seconds[name]}
+            for name in self.chars
+        }
+
+
+def convert_cell(cell: str, numeric: bool, profile: Optional[Profile]) -> Any:
+    if not numeric:
+        return cell
+    elif profile is None:
+        return float(cell)
+    return profile.to_float(cell)
+
+
+async def parser(reader: WithAsyncRead, dialect: csv.Dialect, newline: Optional[str] = None,
+                 skip_blank_lines: bool = False, progress: Optional[Progress] = None,
+                 profile: Optional[Profile] = None) \
+        -> AsyncGenerator[List[str], Optional[List[str]]]:
     state: ParserState = ParserState.AFTER_DELIM
 
+    if newline is None:
+        eol = "\r\n"
+        after_eol = ParserState.EAT_NEWLINE
+    elif newline == "\n" or newline == "\r\n":
+        eol = "\n"
+        after_eol = ParserState.AFTER_ROW
+    else:
+        raise ValueError(f"invalid newline: {newline!r}")
+    crlf = newline == "\r\n"
+
+    if profile is not None:
+        profile.since = time.perf_counter()
     data = await reader.read(READ_SIZE)
     if not isinstance(data, str):
         raise TypeError("file wasn't opened in text mode")
+    if profile is not None:
+        profile.read(len(data))
+    if progress is not None and progress.due(len(data)):
+        await progress.report()
 
     force_save_cell: bool = False
     numeric_cell: bool = False
     row: List[str] = []
     cell: str = ""
+    # (CRLF mode only) A '\r' was seen, which might start a line terminator
+    pending_cr: bool = False
+    # The unquoted cell contains an escaped line break, after which csv.reader
+    # doesn't expect the data to end
+    escaped_eol: bool = False
 
     # Iterate while the reader gives out data
     while data:
@@ -37,6 +153,27 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
         # Iterate charachter-by-charachter over the input file
         # and update the parser state
         for char in data:
+            if profile is not None:
+                profile.step(state)
+
+            # '\r' without a following '\n' is a normal char in the CRLF mode
+            at_eol = char in eol and (pending_cr or not crlf)
+            if pending_cr:
+                pending_cr = False
+                if char != '\n':
+                    if state == ParserState.AFTER_DELIM:
+                        cell += '\r'
+                        state = ParserState.IN_CELL
+                        numeric_cell = dialect.quoting == csv.QUOTE_NONNUMERIC
+                    elif state == ParserState.IN_CELL:
+                        cell += '\r'
+                    else:
+                        cell += '\r'
+                        state = ParserState.IN_CELL
+                        if dialect.strict:
+                            raise csv.Error(
+                                f"'{dialect.delimiter}' expected after '{dialect.quotechar}'"
+                            )
 
             # Switch case depedning on the state
 
@@ -47,8 +184,17 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
             # (fallthrough)
 
             if state == ParserState.AFTER_ROW:
-                yield row
-                row = []
+                if row or not skip_blank_lines:
+                    if progress is not None:
+                        progress.rows += 1
+                    # A list to fill with the next row can be sent to the generator
+                    if profile is not None:
+                        profile.charge(profile.current)
+                    target = yield row
+                    if profile is not None:
+                        profile.resumed()
+                    row = target if target is not None else []
+                    row.clear()
                 state = ParserState.AFTER_DELIM
 
             # (fallthrough)
@@ -60,27 +206,32 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
                     force_save_cell = True
 
                 # 2. Empty field + End of row
-                elif char == '\r' or char == '\n':
+                elif at_eol:
                     if len(row) > 0 or force_save_cell:
                         row.append(cell)
-                    state = ParserState.EAT_NEWLINE
+                    force_save_cell = False
+                    state = after_eol
+
+                # 3. Possible end of row
+                elif char == '\r' and crlf:
+                    pending_cr = True
 
-                # 3. Empty field
+                # 4. Empty field
                 elif char == dialect.delimiter:
                     row.append(cell)
                     cell = ""
                     force_save_cell = False
                     # state stays unchanged (AFTER_DELIM)
 
-                # 4. Start of a quoted cell
+                # 5. Start of a quoted cell
                 elif char == dialect.quotechar and dialect.quoting != csv.QUOTE_NONE:
                     state = ParserState.IN_CELL_QUOTED
 
-                # 5. Start of an escape in an unqoted field
+                # 6. Start of an escape in an unqoted field
                 elif char == dialect.escapechar:
                     state = ParserState.ESCAPE
 
-                # 6. Start of an unquoted field
+                # 7. Start of an unquoted field
                 else:
                     cell += char
                     state = ParserState.IN_CELL
@@ -90,33 +241,40 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
                 # -- Inside an unqouted cell --
 
                 # 1. End of a row
-                if char == '\r' or char == '\n':
-                    row.append(float(cell) if numeric_cell else cell)  # type: ignore
+                if at_eol:
+                    row.append(convert_cell(cell, numeric_cell, profile))
 
                     cell = ""
                     force_save_cell = False
                     numeric_cell = False
-                    state = ParserState.EAT_NEWLINE
+                    escaped_eol = False
+                    state = after_eol
 
-                # 2. End of a cell
+                # 2. Possible end of a row
+                elif char == '\r' and crlf:
+                    pending_cr = True
+
+                # 3. End of a cell
                 elif char == dialect.delimiter:
-                    row.append(float(cell) if numeric_cell else cell)  # type: ignore
+                    row.append(convert_cell(cell, numeric_cell, profile))
 
                     cell = ""
                     force_save_cell = False
                     numeric_cell = False
+                    escaped_eol = False
                     state = ParserState.AFTER_DELIM
 
-                # 3. Start of an espace
+                # 4. Start of an espace
                 elif char == dialect.escapechar:
                     state = ParserState.ESCAPE
 
-                # 4. Normal char
+                # 5. Normal char
                 else:
                     cell += char
 
             elif state == ParserState.ESCAPE:
                 cell += char
+                escaped_eol = char == '\r' or char == '\n'
                 state = ParserState.IN_CELL
 
             elif state == ParserState.IN_CELL_QUOTED:
@@ -126,10 +284,10 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
                 if char == dialect.escapechar:
                     state = ParserState.ESCAPE_QUOTED
 
-                # 2. Quotechar
-                elif dialect.quoting != csv.QUOTE_NONE and char == dialect.quotechar \
-                        and dialect.doublequote:
-                    state = ParserState.QUOTE_IN_QUOTED
+                # 2. Quotechar - a double-quote, or the end of the quoted part of the cell
+                elif dialect.quoting != csv.QUOTE_NONE and char == dialect.quotechar:
+                    state = ParserState.QUOTE_IN_QUOTED if dialect.doublequote \
+                        else ParserState.IN_CELL
 
                 # 3. Every other char
                 else:
@@ -149,20 +307,24 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
                     state = ParserState.IN_CELL_QUOTED
 
                 # 2. End of a row
-                elif char == '\r' or char == '\n':
+                elif at_eol:
                     row.append(cell)
                     cell = ""
                     force_save_cell = False
-                    state = ParserState.EAT_NEWLINE
+                    state = after_eol
 
-                # 3. End of a cell
+                # 3. Possible end of a row
+                elif char == '\r' and crlf:
+                    pending_cr = True
+
+                # 4. End of a cell
                 elif char == dialect.delimiter:
                     row.append(cell)
                     cell = ""
                     force_save_cell = False
                     state = ParserState.AFTER_DELIM
 
-                # 4. Unescaped quotechar
+                # 5. Unescaped quotechar
                 else:
                     cell += char
                     state = ParserState.IN_CELL
@@ -176,11 +338,52 @@ async def parser(reader: WithAsyncRead, dialect: csv.Dialect) -> AsyncIterator[L
                 raise RuntimeError("wtf")
 
         # Read more data
+        if profile is not None:
+            profile.charge(profile.current)
         data = await reader.read(READ_SIZE)
         if not isinstance(data, str):
             raise TypeError("file wasn't opened in text mode")
-
-    if cell or force_save_cell:
-        row.append(float(cell) if numeric_cell else cell)  # type: ignore
-    if row:
+        if profile is not None:
+            profile.read(len(data))
+        if progress is not None and progress.due(len(data)):
+            await progress.report()
+
+    # End of the file - save the last cell, like csv.reader.
+    # (A '\r' right before the end of the file is treated as a line terminator)
+    if state == ParserState.AFTER_DELIM:
+        if row or force_save_cell:
+            row.append(cell)
+
+    elif state == ParserState.IN_CELL or state == ParserState.ESCAPE:
+        if dialect.strict and (escaped_eol or state == ParserState.ESCAPE):
+            raise csv.Error("unexpected end of data")
+        if state == ParserState.ESCAPE:
+            cell += '\n'
+        row.append(convert_cell(cell, numeric_cell, profile))
+
+    elif state == ParserState.IN_CELL_QUOTED or state == ParserState.ESCAPE_QUOTED:
+        if dialect.strict:
+            raise csv.Error("unexpected end of data")
+        if state == ParserState.ESCAPE_QUOTED:
+            cell += '\n'
+        row.append(cell)
+
+    elif state == ParserState.QUOTE_IN_QUOTED:
+        row.append(cell)
+
+    # (With any line terminator, an empty row can only be pending after a blank line
+    # at the start of data)
+    if row or (state in (ParserState.AFTER_ROW, ParserState.EAT_NEWLINE)
+               and not skip_blank_lines):
+        if progress is not None:
+            progress.rows += 1
+        if profile is not None:
+            profile.charge(profile.current)
         yield row
+        if profile is not None:
+            profile.resumed()
+
+    if profile is not None:
+        profile.charge(profile.current)
+    if progress is not None:
+        await progress.report()
@@ -0,0 +1,106 @@
+import csv
+from typing import Any, List, Optional, Sequence, Union
+
+from .dialects import DialectLike, resolve_dialect
+from .extensions import optional_extension
+from .protocols import WithAsyncRead, WithAsyncWrite, WithAsyncWriteBytes
+from .readers import AsyncReader
+from .serializer import make_serializer
+from .writers import AsyncWriter
+
+# Amount of serialized bytes collected before writing them to the destination
+TRANSFORM_BUFFER_SIZE: int = 1 << 16
+
+# Rows written at once by the fallback implementation
+TRANSFORM_BATCH_SIZE: int = 1024
+
+
+def _select_fields(row: List[Any], select: Optional[Sequence[int]]) -> List[Any]:
+    if select is None or not row:
+        return row
+    return [row[i] if i < len(row) else "" for i in select]
+
+
+async def _flush_serializer(serializer: Any, dst: Any, binary: bool) -> None:
+    """Writes (and clears) everything serialized by `serializer` to `dst`."""
+    # The buffer is reused, so dst gets a copy, which it may keep.
+    # The data is dropped even if the write fails, so that it's never written twice.
+    with serializer.getbuffer() as view:
+        data = bytes(view) if binary else str(view, "utf-8")
+    serializer.clear()
+    await dst.write(data)
+
+
+async def _transform_fused(src: WithAsyncRead, dst: Any, select: Optional[Sequence[int]],
+                           dialect_in: csv.Dialect, serializer: Any, binary: bool) -> int:
+    rows = 0
+    try:
+        async for index in index_chunks(src, dialect_in):
+            rows += index.transcribe(serializer, select)
+            if serializer.used >= TRANSFORM_BUFFER_SIZE:
+                await _flush_serializer(serializer, dst, binary)
+
+    finally:
+        # Rows before invalid data are written, like with csv.reader and csv.writer
+        if serializer.used:
+            await _flush_serializer(serializer, dst, binary)
+
+    return rows
+
+
+async def _transform_rows(src: WithAsyncRead, dst: Any, select: Optional[Sequence[int]],
+                          dialect_in: csv.Dialect, dialect_out: csv.Dialect,
+                          binary: bool) -> int:
+    reader = AsyncReader(src, dialect=dialect_in)
+    writer = AsyncWriter(dst, binary=binary, dialect=dialect_out)
+    batch: List[List[Any]] = []
+    rows = 0
+
+    try:
+        async for row in reader:
+            batch.append(_select_fields(row, select))
+            if len(batch) >= TRANSFORM_BATCH_SIZE:
+                full, batch = batch, []
+                await writer.writerows(full)
+                rows += len(full)
+
+    finally:
+        # Rows before invalid data are written, like with csv.reader and csv.writer
+        if batch:
+            await writer.writerows(batch)
+            rows += len(batch)
+
+    return rows
+
+
+async def transform(src: WithAsyncRead, dst: Union[WithAsyncWrite, WithAsyncWriteBytes], *,
+                    select: Optional[Sequence[int]] = None, dialect_in: DialectLike = "excel",
+                    dialect_out: DialectLike = "excel", binary: bool = False) -> int:
+    """Copies CSV rows from `src` to `dst`, converting them from `dialect_in` to `dialect_out`.
+    Returns the number of copied rows.
+
+    If `select` is given, only fields at those indices (in that order) are copied.
+    Fields missing from a row are written as empty strings, but empty rows stay empty.
+
+    The output is exactly what csv.writer would write for rows returned by csv.reader.
+    With the C extension, fields without quotes and escapes are copied straight
+    from the input, without creating Python objects for them.
+
+    If `binary` is set, `dst` receives UTF-8 encoded bytes-like objects.
+    """
+    reader_dialect = resolve_dialect(dialect_in)
+    writer_dialect = resolve_dialect(dialect_out)
+
+    if select is not None:
+        select = list(select)
+        if any(i < 0 for i in select):
+            raise ValueError("selected field indices can't be negative")
+
+    serializer = make_serializer(writer_dialect)
+    if index_chunks is not None and isinstance(serializer, FastSerializer):
+        return await _transform_fused(src, dst, select, reader_dialect, serializer, binary)
+    return await _transform_rows(src, dst, select, reader_dialect, writer_dialect, binary)
+
+
+index_chunks, = optional_extension("_parser", "index_chunks")
+FastSerializer, = optional_extension("_serializer", "Serializer")
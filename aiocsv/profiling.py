@@ -0,0 +1,24 @@
+from typing import Dict, Union
+
+from .extensions import optional_extension
+
+Report = Dict[str, Dict[str, Union[int, float]]]
+
+
+def format_report(report: Report) -> str:
+    """Formats a Profile.report() as a table, with the buckets sorted by time spent."""
+    total = sum(i["seconds"] for i in report.values()) or 1.0
+    lines = [f"{'bucket':<16} {'chars':>12} {'count':>10} {'seconds':>10} {'share':>7}"]
+
+    for name, stats in sorted(report.items(), key=lambda i: i[1]["seconds"], reverse=True):
+        if not stats["chars"] and not stats["count"] and not stats["seconds"]:
+            continue
+        lines.append(f"{name:<16} {stats['chars']:>12} {stats['count']:>10} "
+                     f"{stats['seconds']:>10.6f} {stats['seconds'] / total:>7.1%}")
+
+    return "\n".join(lines)
+
+
+Profile, = optional_extension("_parser", "Profile")
+if Profile is None:
+    from .parser import Profile  # type: ignore
@@ -11,5 +11,13 @@ class WithAsyncWrite(Protocol):
     async def write(self, __b: str) -> Any: ...
 
 
+class WithAsyncWriteBytes(Protocol):
+    async def write(self, __b: bytes) -> Any: ...
+
+
 class WithAsyncRead(Protocol):
     async def read(self, __size: int) -> Union[str, bytes]: ...
+
+
+class WithAsyncDrain(Protocol):
+    async def drain(self) -> Any: ...
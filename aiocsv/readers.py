@@ -1,29 +1,173 @@
 import csv
 from warnings import warn
-from typing import Dict, List, Optional, Sequence
+from typing import (TYPE_CHECKING, Any, Awaitable, Callable, Dict, List, Optional, Sequence, Set,
+                    TypeVar)
+from .dialects import resolve_dialect
+from .instrumentation import Instrumentation, ReadMeter, get_default
+from .extensions import optional_extension
 from .protocols import WithAsyncRead
 
-try:
-    from ._parser import parser
-except ImportError:
-    warn("Using a slow, pure-python CSV parser")
-    from .parser import parser
+if TYPE_CHECKING:
+    from concurrent.futures import Executor
+
+parser, lazy_parser, distinct_parser, DistinctFilter, Profile, Progress = optional_extension(
+    "_parser", "parser", "lazy_parser", "distinct_parser", "DistinctFilter", "Profile", "Progress")
+
+# Set if the C extension is missing; the warning about it is emitted
+# by the first reader, not on import
+_warn_slow_parser = parser is None
+
+if parser is None:
+    from .parser import parser, Profile, Progress  # type: ignore
+
+    # Without the C extension rows are always plain lists
+    async def lazy_parser(reader, dialect, views=False, progress=None):  # type: ignore
+        async for row in parser(reader, dialect, progress=progress):
+            yield [str(cell).encode("utf-8") for cell in row] if views else row
+
+    class DistinctFilter:  # type: ignore
+        """Remembers keys of rows (as tuples, or just their hashes unless `exact` is set),
+        to skip rows with keys seen before"""
+        def __init__(self, columns: Sequence[int], exact: bool = False) -> None:
+            self.columns = list(columns)
+            if any(i < 0 for i in self.columns):
+                raise ValueError("column indices can't be negative")
+            self.exact = exact
+            self.seen: Set[Any] = set()
+
+        def __len__(self) -> int:
+            return len(self.seen)
+
+        def is_new(self, row: List[Any]) -> bool:
+            if not row:
+                return True
+            key: Any = tuple(row[i] if i < len(row) else "" for i in self.columns)
+            if not self.exact:
+                key = hash(key)
+            if key in self.seen:
+                return False
+            self.seen.add(key)
+            return True
+
+    async def distinct_parser(reader, dialect, distinct, lazy=False,  # type: ignore
+                              views=False, progress=None):
+        async for row in parser(reader, dialect, progress=progress):
+            if distinct.is_new(row):
+                yield [str(cell).encode("utf-8") for cell in row] if views else row
+
+# Default amount of characters read between calls to the on_progress callback
+PROGRESS_EVERY: int = 1 << 20
+
+T = TypeVar("T")
 
 
 class AsyncReader:
     """An object that iterates over lines in given asynchronous file.
     Additional keyword arguments are passed to the underlying csv.reader instance.
     Iterating over this object returns parsed CSV rows (List[str]).
+
+    If `lazy` is set, rows are returned as read-only sequences, which only create
+    values of the fields that are actually accessed.
+
+    If `views` is set, rows are lists of UTF-8 encoded bytes-like objects,
+    which share memory with the chunk of input, from which they were parsed.
+
+    If `newline` is "\n" or "\r\n", only that sequence ends rows, and every blank line
+    produces an empty row (unless `skip_blank_lines` is set).
+
+    If `distinct` (a sequence of column indices) is given, rows with the same fields
+    at those columns as an earlier row are skipped (missing fields are empty; empty rows
+    are never skipped). Only 64-bit hashes of the keys are kept, unless `distinct_exact`
+    is set - then all distinct keys are kept in memory (they're never spilled to disk).
+    With the C extension, rows are skipped before any objects are created for them.
+
+    If `on_progress` is provided, it's called with the number of characters read and rows
+    returned so far, every `progress_every_bytes` characters and at the end of the file.
+    It may be a coroutine function.
+
+    Spans and metrics are reported to `instrumentation`
+    (defaults to aiocsv.instrumentation.get_default()).
+
+    If `profile` (an aiocsv.profiling.Profile) is provided, the parser records
+    chars and time spent in its every state.
     """
-    def __init__(self, asyncfile: WithAsyncRead, **csvreaderparams) -> None:
+    def __init__(self, asyncfile: WithAsyncRead, *, lazy: bool = False, views: bool = False,
+                 newline: Optional[str] = None, skip_blank_lines: bool = False,
+                 distinct: Optional[Sequence[int]] = None, distinct_exact: bool = False,
+                 on_progress: Optional[Callable[[int, int], Any]] = None,
+                 progress_every_bytes: int = PROGRESS_EVERY,
+                 instrumentation: Optional[Instrumentation] = None,
+                 profile: Optional[Profile] = None, _cache_dir: Optional[str] = None,
+                 _reader_name: Optional[str] = None, **csvreaderparams) -> None:
+        global _warn_slow_parser
+        if _warn_slow_parser:
+            _warn_slow_parser = False
+            warn("Using a slow, pure-python CSV parser", stacklevel=2)
+
         self._file = asyncfile
 
+        # Reads from the file are passed through the meter
+        instrumentation = instrumentation or get_default()
+        self._meter: Optional[ReadMeter] = None
+        if instrumentation is not None:
+            self._meter = ReadMeter(instrumentation, asyncfile,
+                                    {"aiocsv.reader": _reader_name or type(self).__name__})
+            asyncfile = self._meter
+
         # csv.Dialect isn't a class, instead it's a weird proxy
         # (at least in CPython) to _csv.Dialect. Instead of figuring how
-        # this shit works, just let `csv` figure the dialects out.
-        self.dialect = csv.reader("", **csvreaderparams).dialect
+        # this shit works, just let `csv` figure the dialects out (see resolve_dialect).
+        self.dialect = resolve_dialect(**csvreaderparams)
+
+        if newline not in (None, "\n", "\r\n"):
+            raise ValueError(f"invalid newline: {newline!r}")
+
+        progress = Progress(on_progress, progress_every_bytes) if on_progress else None
+
+        if _cache_dir is not None:
+            # Only created by from_path, with an ExecutorFile
+            from .cache import cached_parser
+            if lazy or newline is not None or skip_blank_lines or profile is not None \
+                    or distinct is not None:
+                raise ValueError("lazy, newline, skip_blank_lines, distinct and profile "
+                                 "can't be used with cache_dir")
+            self._parser = cached_parser(self._file, self.dialect, _cache_dir, views, progress,
+                                         asyncfile)
+        elif lazy or views or distinct is not None:
+            if newline is not None or skip_blank_lines or profile is not None:
+                raise ValueError("newline, skip_blank_lines and profile can't be used "
+                                 "with lazy, views or distinct")
+            if distinct is not None:
+                self._parser = distinct_parser(asyncfile, self.dialect,
+                                               DistinctFilter(distinct, distinct_exact), lazy,
+                                               views, progress)
+            else:
+                self._parser = lazy_parser(asyncfile, self.dialect, views, progress)
+        else:
+            self._parser = parser(asyncfile, self.dialect, newline, skip_blank_lines, progress,
+                                  profile)
+        self._reusable = not (lazy or views or distinct is not None or _cache_dir is not None)
+        self._started = False
+
+    @classmethod
+    def from_path(cls, path: str, *, cache_dir: Optional[str] = None, encoding: str = "utf-8",
+                  executor: Optional["Executor"] = None, **kwargs) -> "AsyncReader":
+        """Creates a reader of the file at `path`, opened and read on `executor`
+        (the default one if None). Other keyword arguments are passed to the constructor.
 
-        self._parser = parser(self._file, self.dialect)
+        If `cache_dir` is given, parsed rows are also saved to a binary cache file there;
+        the next reader of the same, unmodified file (with the same dialect) reads
+        the memory-mapped cache instead of parsing the file again. The cache requires
+        the C extension (without it, `cache_dir` is ignored), and can't be used with `lazy`,
+        `newline`, `skip_blank_lines`, `distinct` or `profile`.
+        """
+        # Imported here, so that importing readers doesn't import asyncio (and a lot more)
+        from .streams import ExecutorFile
+        if cache_dir is not None:
+            from .cache import CachedRows
+            if CachedRows is None:
+                cache_dir = None
+        return cls(ExecutorFile(path, executor, encoding), _cache_dir=cache_dir, **kwargs)
 
     @property
     def line_num(self) -> int:
@@ -34,7 +178,71 @@ class AsyncReader:
         return self
 
     async def __anext__(self) -> List[str]:
-        return await self._parser.__anext__()
+        self._started = True
+        if self._meter is None:
+            return await self._parser.__anext__()
+
+        row = await self._metered(self._parser.__anext__())
+        self._meter.add_rows(1)
+        return row
+
+    async def _metered(self, awaitable: Awaitable[T]) -> T:
+        """Awaits the awaitable, ending the meter's span on EOF or error."""
+        assert self._meter is not None
+        try:
+            return await awaitable
+        except StopAsyncIteration:
+            self._meter.finish()
+            raise
+        except BaseException as e:
+            self._meter.finish(e)
+            raise
+
+    async def readbatch(self, size: int = 1024,
+                        rows: Optional[List[List[str]]] = None) -> List[List[str]]:
+        """Reads up to `size` rows; an empty list is returned on EOF.
+
+        If `rows` is provided, it's filled in-place and returned; lists which
+        it already contains are reused for the new rows, and any extra lists are removed.
+        """
+        if rows is None:
+            rows = []
+
+        if self._meter is None:
+            return await self._readbatch(size, rows)
+
+        with self._meter.instrumentation.start_span("aiocsv.parse_batch",
+                                                    self._meter.attributes) as span:
+            await self._readbatch(size, rows)
+            span.set_attribute("aiocsv.rows", len(rows))
+
+        self._meter.add_rows(len(rows))
+        return rows
+
+    async def _readbatch(self, size: int, rows: List[List[str]]) -> List[List[str]]:
+        count = 0
+        try:
+            while count < size:
+                # The first row is always parsed into a new list
+                target = rows[count] if count < len(rows) and self._reusable and self._started \
+                    else None
+                self._started = True
+                if self._meter is None:
+                    row = await self._parser.asend(target)
+                else:
+                    row = await self._metered(self._parser.asend(target))
+
+                if count < len(rows):
+                    rows[count] = row
+                else:
+                    rows.append(row)
+                count += 1
+
+        except StopAsyncIteration:
+            pass
+
+        del rows[count:]
+        return rows
 
 
 class AsyncDictReader:
@@ -51,7 +259,7 @@ class AsyncDictReader:
         self.fieldnames: Optional[List[str]] = list(fieldnames) if fieldnames else None
         self.restkey: Optional[str] = restkey
         self.restval: Optional[str] = restval
-        self.reader = AsyncReader(asyncfile, **csvreaderparams)
+        self.reader = AsyncReader(asyncfile, _reader_name="AsyncDictReader", **csvreaderparams)
 
     @property
     def dialect(self) -> csv.Dialect:
@@ -0,0 +1,82 @@
+import codecs
+import csv
+import io
+from typing import Any, Iterable, Union
+
+from .extensions import optional_extension
+
+# Minimal size of the buffer, to which serialized rows are appended
+MIN_BUFFER_SIZE: int = 4096
+
+
+class Serializer:
+    """Serializes CSV rows with csv.writer, and encodes them into a reusable buffer.
+
+    Only the first `used` bytes of the buffer are meaningful - see getbuffer().
+    """
+    def __init__(self, dialect: csv.Dialect, buffer_size: int = MIN_BUFFER_SIZE,
+                 encoding: str = "utf-8", errors: str = "strict") -> None:
+        self._text = io.StringIO(newline="")
+        self._writer = csv.writer(self._text, dialect)
+        self._encoder = codecs.getincrementalencoder(encoding)(errors)
+        self._dialect = dialect
+        self._encoding = encoding
+        self._errors = errors
+
+        self.buffer = bytearray(max(buffer_size, MIN_BUFFER_SIZE))
+        self.used: int = 0
+
+    def _encode_text(self) -> None:
+        data = self._encoder.encode(self._text.getvalue())
+        self._text.seek(0)
+        self._text.truncate(0)
+
+        end = self.used + len(data)
+        self.buffer[self.used:end] = data
+        self.used = end
+
+    def writerow(self, row: Iterable[Any]) -> None:
+        """Serializes a single row and appends it to the buffer."""
+        self._writer.writerow(row)
+        self._encode_text()
+
+    def writerows(self, rows: Iterable[Iterable[Any]]) -> None:
+        """Serializes multiple rows and appends them to the buffer."""
+        self._writer.writerows(rows)
+        self._encode_text()
+
+    def getbuffer(self) -> memoryview:
+        """Returns a memoryview over the used part of the buffer.
+        The view has to be released before anything else is written."""
+        return memoryview(self.buffer)[:self.used]
+
+    def clear(self) -> None:
+        """Marks the whole buffer as unused, without deallocating it."""
+        self.used = 0
+
+    def dumps(self, rows: Iterable[Iterable[Any]], text: bool = False) -> Union[bytes, str]:
+        """Serializes multiple rows into a new bytes object (or str, if `text` is set),
+        without touching the buffer. Every call is encoded separately, so it can be used
+        from multiple threads at once."""
+        buffer = io.StringIO(newline="")
+        csv.writer(buffer, self._dialect).writerows(rows)
+        data = buffer.getvalue()
+        return data if text else data.encode(self._encoding, self._errors)
+
+
+def make_serializer(dialect: csv.Dialect, buffer_size: int = MIN_BUFFER_SIZE,
+                    encoding: str = "utf-8", errors: str = "strict") -> Serializer:
+    """Returns the fastest available serializer, which can handle the given
+    dialect and encoding."""
+    if _FastSerializer is not None and codecs.lookup(encoding).name == "utf-8" \
+            and errors == "strict":
+        try:
+            return _FastSerializer(dialect, buffer_size)  # type: ignore
+        except ValueError:
+            # Dialect not supported by the fast serializer
+            pass
+
+    return Serializer(dialect, buffer_size, encoding, errors)
+
+
+_FastSerializer, = optional_extension("_serializer", "Serializer")
@@ -0,0 +1,341 @@
+import asyncio
+import csv
+import heapq
+import os
+import tempfile
+from concurrent.futures import Executor, ThreadPoolExecutor
+from itertools import islice
+from typing import IO, Any, Callable, Iterable, Iterator, List, Optional, Sequence, Set, Union
+
+from .dialects import DialectLike, resolve_dialect
+from .extensions import optional_extension
+from .pipeline import TRANSFORM_BATCH_SIZE, TRANSFORM_BUFFER_SIZE, _flush_serializer
+from .protocols import WithAsyncRead, WithAsyncWrite, WithAsyncWriteBytes
+from .readers import AsyncReader
+from .serializer import make_serializer
+from .streams import ExecutorFile
+from .writers import AsyncWriter
+
+# Approximate memory used by a sorted run, per character of its data
+# (the data itself, the index of its fields, extracted keys and the serialized output)
+RUN_MEMORY_PER_CHAR: int = 4
+
+SortKey = Optional[Callable[[List[Any]], Any]]
+
+
+class _Reversed:
+    """Inverts the ordering of a sort key, for merging runs sorted in reverse"""
+    __slots__ = ("key",)
+
+    def __init__(self, key: Any) -> None:
+        self.key = key
+
+    def __lt__(self, other: "_Reversed") -> bool:
+        return other.key < self.key
+
+    def __eq__(self, other: object) -> bool:
+        return isinstance(other, _Reversed) and self.key == other.key
+
+
+def _run_dialect(dialect: csv.Dialect) -> csv.Dialect:
+    """Dialect of temporary run files. QUOTE_NONNUMERIC is preserved, so that floats
+    are read back as floats."""
+    quoting = csv.QUOTE_NONNUMERIC if dialect.quoting == csv.QUOTE_NONNUMERIC \
+        else csv.QUOTE_MINIMAL
+    return resolve_dialect(quoting=quoting)
+
+
+def _sort_keys(index: Any, key_columns: Sequence[int], key: SortKey,
+               first: int = 0) -> List[Any]:
+    """Returns values to compare for all rows of the index (None for empty rows,
+    and rows before `first`). A single key field is compared directly,
+    which is much faster than comparing lists."""
+    keys = index.materialize(key_columns)
+    keys[:first] = [[]] * first
+    if key is not None:
+        return [key(k) if k else None for k in keys]
+    elif len(key_columns) == 1:
+        return [k[0] if k else None for k in keys]
+    return [k or None for k in keys]
+
+
+def _sorted_rows(index: Any, first: int, key_columns: Sequence[int], key: SortKey,
+                 reverse: bool) -> List[int]:
+    """Returns numbers of non-empty rows of the index (starting with `first`), in sorted order.
+    Only the key fields are converted into Python objects."""
+    keys = _sort_keys(index, key_columns, key, first)
+    order = [r for r in range(first, len(keys)) if keys[r] is not None]
+    order.sort(key=keys.__getitem__, reverse=reverse)
+    return order
+
+
+def _spill_run(index: Any, first: int, key_columns: Sequence[int], key: SortKey,
+               reverse: bool, run_dialect: csv.Dialect, path: str) -> int:
+    """Sorts rows of the index, and writes them to a temporary file. Runs on an executor."""
+    order = _sorted_rows(index, first, key_columns, key, reverse)
+    serializer = FastSerializer(run_dialect)
+    index.transcribe(serializer, rows=order)
+    with open(path, "wb") as f, serializer.getbuffer() as view:
+        f.write(view)
+    return len(order)
+
+
+def _write_run(run: List[List[Any]], run_dialect: csv.Dialect, path: str) -> IO[str]:
+    """Writes a sorted run to a temporary file, and returns the file opened for reading it
+    back. Runs on an executor."""
+    f = open(path, "w+", encoding="utf-8", newline="")
+    try:
+        csv.writer(f, run_dialect).writerows(run)
+        f.seek(0)
+    except BaseException:
+        f.close()
+        raise
+    return f
+
+
+class _RunCursor:
+    """Position in a sorted run, which is indexed chunk by chunk"""
+    def __init__(self, chunks: Any, key_columns: Sequence[int], key: SortKey,
+                 reverse: bool) -> None:
+        self.chunks = chunks
+        self.key_columns = key_columns
+        self.key = key
+        self.reverse = reverse
+        self.index: Any = None
+        self.keys: List[Any] = []
+        self.row = -1
+
+    async def advance(self) -> bool:
+        """Moves to the next row. Returns False at the end of the run."""
+        self.row += 1
+        while self.row >= len(self.keys):
+            try:
+                self.index = await self.chunks.__anext__()
+            except StopAsyncIteration:
+                return False
+            self.keys = _sort_keys(self.index, self.key_columns, self.key)
+            if self.reverse:
+                self.keys = [_Reversed(k) for k in self.keys]
+            self.row = 0
+        return True
+
+
+async def _merge_runs(cursors: List[_RunCursor], serializer: Any, dst: Any,
+                      binary: bool) -> int:
+    """Merges sorted runs into `dst`. Ties are resolved in favor of earlier runs."""
+    heap = []
+    for i, cursor in enumerate(cursors):
+        if await cursor.advance():
+            heap.append((cursor.keys[cursor.row], i))
+    heapq.heapify(heap)
+
+    rows = 0
+    batch_index: Any = None
+    batch: List[int] = []
+
+    while heap:
+        i = heap[0][1]
+        cursor = cursors[i]
+
+        # Consecutive rows from a single chunk are serialized at once
+        if cursor.index is not batch_index or len(batch) >= TRANSFORM_BATCH_SIZE:
+            if batch:
+                rows += batch_index.transcribe(serializer, rows=batch)
+                batch = []
+                if serializer.used >= TRANSFORM_BUFFER_SIZE:
+                    await _flush_serializer(serializer, dst, binary)
+            batch_index = cursor.index
+
+        batch.append(cursor.row)
+        if await cursor.advance():
+            heapq.heapreplace(heap, (cursor.keys[cursor.row], i))
+        else:
+            heapq.heappop(heap)
+
+    if batch:
+        rows += batch_index.transcribe(serializer, rows=batch)
+    return rows
+
+
+async def _sort_indexed(src: WithAsyncRead, dst: Any, key_columns: Sequence[int],
+                        memory_limit: int, key: SortKey, reverse: bool, header: bool,
+                        dialect_in: csv.Dialect, serializer: Any, binary: bool,
+                        workers: int, executor: Executor, directory: str) -> int:
+    loop = asyncio.get_event_loop()
+    run_dialect = _run_dialect(dialect_in)
+    run_chars = max(1, memory_limit // RUN_MEMORY_PER_CHAR // (workers + 1))
+    runs: List[str] = []
+    spills: Set["asyncio.Future[int]"] = set()
+    rows = 0
+
+    # The last chunk is only spilled once the next one arrives -
+    # so that inputs fitting into a single run are never written to disk
+    previous: Any = None
+    previous_first = 0
+
+    async def spill() -> None:
+        nonlocal spills
+        if len(spills) >= workers:
+            done, spills = await asyncio.wait(spills, return_when=asyncio.FIRST_COMPLETED)
+            await asyncio.gather(*done)
+
+        path = os.path.join(directory, f"run{len(runs)}.csv")
+        runs.append(path)
+        spills.add(loop.run_in_executor(executor, _spill_run, previous, previous_first,
+                                        key_columns, key, reverse, run_dialect, path))
+
+    try:
+        async for index in index_chunks(src, dialect_in, min_chunk=run_chars,
+                                        executor=executor):
+            if previous is not None:
+                await spill()
+
+            previous, previous_first = index, 0
+            if header and not rows and len(index):
+                rows += index.transcribe(serializer, rows=[0])
+                previous_first = 1
+
+        if not runs:
+            # Everything fits into a single run
+            if previous is not None:
+                order = await loop.run_in_executor(executor, _sorted_rows, previous,
+                                                   previous_first, key_columns, key, reverse)
+                rows += previous.transcribe(serializer, rows=order)
+            return rows
+
+        await spill()
+        await asyncio.gather(*spills)
+        spills.clear()
+
+    finally:
+        if spills:
+            # Only reached on errors, which take precedence over the ones of other spills
+            await asyncio.gather(*spills, return_exceptions=True)
+
+    # Merge the runs, reading a part of each one at a time
+    files = [ExecutorFile(path, executor) for path in runs]
+    try:
+        merge_chunk = max(1, memory_limit // RUN_MEMORY_PER_CHAR // len(files))
+        cursors = [
+            _RunCursor(index_chunks(f, run_dialect, min_chunk=merge_chunk), key_columns, key,
+                       reverse)
+            for f in files
+        ]
+        rows += await _merge_runs(cursors, serializer, dst, binary)
+    finally:
+        for f in files:
+            f.close()
+
+    return rows
+
+
+async def _sort_rows(src: WithAsyncRead, dst: Any, key_columns: Sequence[int],
+                     memory_limit: int, key: SortKey, reverse: bool, header: bool,
+                     dialect_in: csv.Dialect, dialect_out: csv.Dialect, binary: bool,
+                     executor: Optional[Executor], directory: str) -> int:
+    """Fallback for sort, without the C extensions. Runs are written and merged
+    on `executor`, as that reads them back from disk."""
+    loop = asyncio.get_event_loop()
+    run_dialect = _run_dialect(dialect_in)
+    reader = AsyncReader(src, dialect=dialect_in)
+    writer = AsyncWriter(dst, binary=binary, dialect=dialect_out)
+    rows = 0
+
+    def sort_key(row: List[Any]) -> Any:
+        fields = [row[i] if i < len(row) else "" for i in key_columns]
+        return key(fields) if key is not None else fields
+
+    runs: List[Iterable[List[Any]]] = []
+    files: List[IO[str]] = []
+    run: List[List[Any]] = []
+    run_chars = 0
+
+    try:
+        async for row in reader:
+            if header and not rows:
+                await writer.writerow(row)
+                rows += 1
+            elif row:
+                run.append(row)
+                run_chars += sum(len(str(i)) for i in row) + len(row)
+
+            if run_chars * RUN_MEMORY_PER_CHAR >= memory_limit:
+                run.sort(key=sort_key, reverse=reverse)
+                f = await loop.run_in_executor(executor, _write_run, run, run_dialect,
+                                               os.path.join(directory, f"run{len(runs)}.csv"))
+                files.append(f)
+                runs.append(csv.reader(f, run_dialect))
+                run, run_chars = [], 0
+
+        run.sort(key=sort_key, reverse=reverse)
+        runs.append(run)
+
+        merged: Iterator[List[Any]] = heapq.merge(*runs, key=sort_key, reverse=reverse)
+        while True:
+            batch = await loop.run_in_executor(executor, list,
+                                               islice(merged, TRANSFORM_BATCH_SIZE))
+            if not batch:
+                break
+            await writer.writerows(batch)
+            rows += len(batch)
+
+    finally:
+        for f in files:
+            f.close()
+
+    return rows
+
+
+async def sort(src: WithAsyncRead, dst: Union[WithAsyncWrite, WithAsyncWriteBytes],
+               key_columns: Sequence[int], *, memory_limit: int = 1 << 26,
+               key: SortKey = None, reverse: bool = False, header: bool = False,
+               dialect_in: DialectLike = "excel", dialect_out: DialectLike = "excel",
+               binary: bool = False, workers: Optional[int] = None,
+               executor: Optional[Executor] = None, tmpdir: Optional[str] = None) -> int:
+    """Sorts CSV rows from `src` by fields at `key_columns`, and writes them to `dst`.
+    Returns the number of written rows. The sort is stable; empty rows are skipped.
+
+    `key`, if given, is called with a list of the key fields of a row, and returns
+    the value to compare. If `header` is set, the first row is written first, unsorted.
+
+    Input which doesn't fit into `memory_limit` bytes (approximately) is split into
+    sorted runs, which are written to temporary files (in `tmpdir`) and then merged.
+    With the C extensions, only the key fields are converted into Python objects.
+    Chunks are indexed one after another on `executor`, while up to `workers` previous
+    runs (defaults to the number of CPUs) are sorted and written there - sorting holds
+    the GIL, so that mostly overlaps reading and indexing with sorting. Without them,
+    run files are still written and read on `executor` (or the loop's default executor).
+    """
+    reader_dialect = resolve_dialect(dialect_in)
+    writer_dialect = resolve_dialect(dialect_out)
+
+    key_columns = list(key_columns)
+    if not key_columns:
+        raise ValueError("at least one key column is required")
+    if any(i < 0 for i in key_columns):
+        raise ValueError("key column indices can't be negative")
+
+    with tempfile.TemporaryDirectory(prefix="aiocsv-sort-", dir=tmpdir) as directory:
+        serializer = make_serializer(writer_dialect)
+        if index_chunks is None or not isinstance(serializer, FastSerializer):
+            return await _sort_rows(src, dst, key_columns, memory_limit, key, reverse, header,
+                                    reader_dialect, writer_dialect, binary, executor,
+                                    directory)
+
+        workers = workers or os.cpu_count() or 1
+        own_executor = executor is None
+        executor = executor or ThreadPoolExecutor(workers, "aiocsv-sort")
+        try:
+            rows = await _sort_indexed(src, dst, key_columns, memory_limit, key, reverse,
+                                       header, reader_dialect, serializer, binary, workers,
+                                       executor, directory)
+            if serializer.used:
+                await _flush_serializer(serializer, dst, binary)
+            return rows
+        finally:
+            if own_executor:
+                executor.shutdown(wait=False)
+
+
+index_chunks, = optional_extension("_parser", "index_chunks")
+FastSerializer, = optional_extension("_serializer", "Serializer")
@@ -0,0 +1,340 @@
+import asyncio
+import codecs
+import csv
+from collections import deque
+from concurrent.futures import Executor
+from typing import IO, Any, Deque, Iterable, List, Optional
+
+from .dialects import resolve_dialect
+from .protocols import WithAsyncDrain
+from .serializer import make_serializer
+
+# Default size of the buffer, to which incoming bytes are written by the transport
+BUFFER_SIZE: int = 65536
+
+# Amount of decoded-but-unread characters, above which reading from the transport is paused
+HIGH_WATER: int = 4 * BUFFER_SIZE
+
+# Amount of full buffers, after which AsyncTransportWriter.writerows sends the data
+BATCH_BUFFERS: int = 16
+
+
+class ExecutorFile:
+    """WithAsyncRead over a text file, opened and read on an executor
+    (the default one if None). The file is closed at its end."""
+    def __init__(self, path: str, executor: Optional[Executor] = None,
+                 encoding: str = "utf-8") -> None:
+        self.path = path
+        self.executor = executor
+        self.encoding = encoding
+        self.file: Optional[IO[str]] = None
+        self.closed = False
+
+    def _read(self, size: int) -> str:
+        if self.closed:
+            return ""
+        if self.file is None:
+            self.file = open(self.path, "r", encoding=self.encoding, newline="")
+        data = self.file.read(size)
+        if not data:
+            self.close()
+        return data
+
+    async def read(self, size: int) -> str:
+        return await asyncio.get_event_loop().run_in_executor(self.executor, self._read, size)
+
+    def close(self) -> None:
+        self.closed = True
+        if self.file is not None:
+            self.file.close()
+            self.file = None
+
+
+class FlowControl:
+    """Mixin for asyncio protocols, which tracks the pause_writing/resume_writing calls
+    made by the transport, and provides a drain() coroutine (like asyncio.StreamWriter).
+    """
+    def __init__(self, *args: Any, **kwargs: Any) -> None:
+        super().__init__(*args, **kwargs)  # type: ignore
+        self._writing_paused: bool = False
+        self._connection_lost: bool = False
+        self._drain_waiter: Optional[asyncio.Future] = None
+
+    def pause_writing(self) -> None:
+        self._writing_paused = True
+
+    def resume_writing(self) -> None:
+        self._writing_paused = False
+        if self._drain_waiter is not None and not self._drain_waiter.done():
+            self._drain_waiter.set_result(None)
+
+    def connection_lost(self, exc: Optional[BaseException]) -> None:
+        self._connection_lost = True
+        if self._drain_waiter is not None and not self._drain_waiter.done():
+            if exc is None:
+                self._drain_waiter.set_result(None)
+            else:
+                self._drain_waiter.set_exception(exc)
+
+    async def drain(self) -> None:
+        """Waits until the transport's write buffer drops below its low-water mark."""
+        if self._connection_lost:
+            raise ConnectionResetError("Connection lost")
+
+        if not self._writing_paused:
+            return
+
+        if self._drain_waiter is None or self._drain_waiter.done():
+            self._drain_waiter = asyncio.get_event_loop().create_future()
+        await self._drain_waiter
+
+
+class CsvWriterProtocol(FlowControl, asyncio.Protocol):
+    """A bare asyncio.Protocol with FlowControl, for connections which are only written to.
+    """
+    def __init__(self) -> None:
+        super().__init__()
+        self.transport: Optional[asyncio.BaseTransport] = None
+
+    def connection_made(self, transport: asyncio.BaseTransport) -> None:
+        self.transport = transport
+
+
+# asyncio.BufferedProtocol was added in Python 3.7,
+# older event loops call data_received of any protocol
+_BufferedProtocol: Any = getattr(asyncio, "BufferedProtocol", asyncio.Protocol)
+
+
+class CsvStreamProtocol(FlowControl, _BufferedProtocol):
+    """An asyncio.BufferedProtocol, which can be passed to AsyncReader or AsyncDictReader.
+
+    Incoming bytes are written by the transport directly into a preallocated buffer
+    (owned by this object), and are decoded straight from that buffer - no intermediate
+    bytes objects are created for every received chunk.
+
+    The object fulfills the aiocsv.protocols.WithAsyncRead protocol,
+    and thanks to FlowControl can also be passed to AsyncTransportWriter.
+    """
+    def __init__(self, encoding: str = "utf-8", errors: str = "strict",
+                 buffer_size: int = BUFFER_SIZE, high_water: int = HIGH_WATER) -> None:
+        super().__init__()
+        self.encoding = codecs.lookup(encoding).name
+        self.errors = errors
+        self.high_water = high_water
+
+        self.transport: Optional[asyncio.BaseTransport] = None
+
+        self._buffer = bytearray(buffer_size)
+        self._view = memoryview(self._buffer)
+
+        # Amount of bytes at the beginning of the buffer, which belong to
+        # an incomplete multi-byte character
+        self._leftover: int = 0
+
+        # UTF-8 can be decoded without any copying, other encodings go through
+        # an incremental decoder
+        self._decoder = None if self.encoding == "utf-8" \
+            else codecs.getincrementaldecoder(self.encoding)(errors)
+
+        self._text: Deque[str] = deque()
+        self._text_len: int = 0
+        self._eof: bool = False
+        self._exception: Optional[BaseException] = None
+        self._waiter: Optional[asyncio.Future] = None
+        self._reading_paused: bool = False
+
+    # Protocol callbacks
+
+    def connection_made(self, transport: asyncio.BaseTransport) -> None:
+        self.transport = transport
+
+    def connection_lost(self, exc: Optional[BaseException]) -> None:
+        super().connection_lost(exc)
+        if exc is not None:
+            self._exception = exc
+        self._finish_decoding()
+        self._eof = True
+        self._wake_up()
+
+    def get_buffer(self, sizehint: int) -> memoryview:
+        return self._view[self._leftover:]
+
+    def buffer_updated(self, nbytes: int) -> None:
+        end = self._leftover + nbytes
+
+        if self._decoder is None:
+            text, consumed = codecs.utf_8_decode(self._view[:end], self.errors, False)
+
+            # Move the incomplete character to the beginning of the buffer
+            self._leftover = end - consumed
+            if self._leftover:
+                self._buffer[:self._leftover] = bytes(self._view[consumed:end])
+
+        else:
+            text = self._decoder.decode(self._view[:end])
+
+        self._push_text(text)
+
+    def data_received(self, data: bytes) -> None:
+        """Only called on Python 3.6 - copies the data into the buffer."""
+        view = memoryview(data)
+        while view:
+            buffer = self.get_buffer(len(view))
+            n = min(len(buffer), len(view))
+            buffer[:n] = view[:n]
+            self.buffer_updated(n)
+            view = view[n:]
+
+    def eof_received(self) -> bool:
+        self._finish_decoding()
+        self._eof = True
+        self._wake_up()
+        return False
+
+    # WithAsyncRead implementation
+
+    async def read(self, size: int = -1) -> str:
+        """Returns at most `size` decoded characters (or everything which is available,
+        if size is negative). An empty string is returned only on EOF."""
+        while not self._text and not self._eof and self._exception is None:
+            self._waiter = asyncio.get_event_loop().create_future()
+            try:
+                await self._waiter
+            finally:
+                self._waiter = None
+
+        if self._exception is not None and not self._text:
+            raise self._exception
+
+        if not self._text:
+            return ""
+
+        chunk = self._text.popleft()
+        if 0 <= size < len(chunk):
+            self._text.appendleft(chunk[size:])
+            chunk = chunk[:size]
+
+        self._text_len -= len(chunk)
+        self._maybe_resume_reading()
+        return chunk
+
+    # Helpers
+
+    def _push_text(self, text: str) -> None:
+        if not text:
+            return
+
+        self._text.append(text)
+        self._text_len += len(text)
+        self._wake_up()
+
+        if self._text_len > self.high_water and not self._reading_paused \
+                and isinstance(self.transport, asyncio.ReadTransport):
+            self._reading_paused = True
+            self.transport.pause_reading()
+
+    def _maybe_resume_reading(self) -> None:
+        if self._reading_paused and self._text_len <= self.high_water // 2:
+            self._reading_paused = False
+            self.transport.resume_reading()  # type: ignore
+
+    def _finish_decoding(self) -> None:
+        if self._eof:
+            return
+
+        if self._decoder is None:
+            text, _ = codecs.utf_8_decode(self._view[:self._leftover], self.errors, True)
+            self._leftover = 0
+        else:
+            text = self._decoder.decode(b"", True)
+
+        self._push_text(text)
+
+    def _wake_up(self) -> None:
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+
+
+class AsyncTransportWriter:
+    """An object that writes csv rows directly to an asyncio transport.
+    In this object "row" is a sequence of values.
+
+    Rows are serialized (straight to UTF-8, if possible) into a reusable buffer,
+    which is handed over to the transport (with transport.writelines)
+    once it grows over `buffer_size` bytes,
+    at the end of every writerows() call, and on flush().
+    After handing data over, the writer awaits `flow.drain()`, honoring the
+    pause_writing/resume_writing flow control of the transport. `flow` is usually
+    a FlowControl protocol or an asyncio.StreamWriter.
+
+    Additional keyword arguments are understood as dialect parameters.
+    """
+    def __init__(self, transport: asyncio.WriteTransport, flow: WithAsyncDrain,
+                 encoding: str = "utf-8", errors: str = "strict",
+                 buffer_size: int = BUFFER_SIZE, **csvwriterparams) -> None:
+        self.transport = transport
+        self.flow = flow
+        self.buffer_size = buffer_size
+
+        self._dialect = resolve_dialect(**csvwriterparams)
+        self._serializer = make_serializer(self._dialect, buffer_size, encoding, errors)
+        self._batch: List[bytes] = []
+
+    @property
+    def dialect(self) -> csv.Dialect:
+        return self._dialect
+
+    def _maybe_cut_batch(self) -> None:
+        if self._serializer.used >= self.buffer_size:
+            self._cut_batch()
+
+    def _cut_batch(self) -> None:
+        """Moves the serialized rows to the batch of data waiting to be sent.
+        A copy has to be made, as transports may hold on to unsent data."""
+        if self._serializer.used:
+            self._batch.append(bytes(self._serializer.getbuffer()))
+            self._serializer.clear()
+
+    async def _send_batch(self) -> None:
+        if self._batch:
+            self.transport.writelines(self._batch)
+            self._batch.clear()
+            await self.flow.drain()
+
+    async def writerow(self, row: Iterable[Any]) -> None:
+        """Writes one row to the buffer, sending the buffer if it's full."""
+        self._serializer.writerow(row)
+        self._maybe_cut_batch()
+        await self._send_batch()
+
+    async def writerows(self, rows: Iterable[Iterable[Any]]) -> None:
+        """Writes multiple rows to the transport. Full buffers are sent in batches
+        of BATCH_BUFFERS with a single writelines() call."""
+        for row in rows:
+            self._serializer.writerow(row)
+            self._maybe_cut_batch()
+
+            if len(self._batch) >= BATCH_BUFFERS:
+                await self._send_batch()
+
+        self._cut_batch()
+        await self._send_batch()
+
+    async def flush(self) -> None:
+        """Sends all buffered rows to the transport and waits for it to drain."""
+        self._cut_batch()
+        await self._send_batch()
+        await self.flow.drain()
+
+
+async def open_connection(host: Optional[str] = None, port: Optional[int] = None, *,
+                          encoding: str = "utf-8", errors: str = "strict",
+                          buffer_size: int = BUFFER_SIZE, **kwds: Any) -> CsvStreamProtocol:
+    """Opens a connection to the given host and returns a CsvStreamProtocol
+    reading from it. Additional keyword arguments are passed to loop.create_connection."""
+    loop = asyncio.get_event_loop()
+    _, protocol = await loop.create_connection(
+        lambda: CsvStreamProtocol(encoding, errors, buffer_size),
+        host, port, **kwds
+    )
+    return protocol
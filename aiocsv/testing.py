@@ -0,0 +1,75 @@
+import csv
+import random
+from typing import List, Optional
+
+# Modes of AdversarialSource
+MODES = ("exact", "random", "single", "pairs")
+
+
+class AdversarialSource:
+    """WithAsyncRead over a string, which splits the data between reads
+    in ways that stress parsers:
+
+    - "exact": returns exactly the requested number of characters, like a regular file,
+    - "random": returns between 1 and `max_read` characters (seeded with `seed`),
+    - "single": returns a single character from every read,
+    - "pairs": ends reads between "\\r\\n", doubled quotechars, and right after escapechars
+      (using the quotechar and escapechar of `dialect`).
+
+    Reads never return more characters than requested.
+    """
+    def __init__(self, data: str, mode: str = "random", *, max_read: int = 16,
+                 seed: Optional[int] = None, dialect: Optional[csv.Dialect] = None) -> None:
+        if mode not in MODES:
+            raise ValueError(f"invalid mode: {mode!r}")
+
+        self.data = data
+        self.mode = mode
+        self.max_read = max(max_read, 1)
+        self.random = random.Random(seed)
+        self.position = 0
+        self.reads = 0
+
+        self._splits: List[int] = []
+        self._next_split = 0
+        if mode == "pairs":
+            self._splits = split_points(data, dialect or csv.get_dialect("excel"))
+
+    async def read(self, size: int = -1) -> str:
+        self.reads += 1
+        remaining = len(self.data) - self.position
+        if size < 0 or size > remaining:
+            size = remaining
+
+        if self.mode == "random":
+            size = min(size, self.random.randint(1, self.max_read))
+        elif self.mode == "single":
+            size = min(size, 1)
+        elif self.mode == "pairs":
+            size = min(size, self._until_split())
+
+        chunk = self.data[self.position:self.position + size]
+        self.position += size
+        return chunk
+
+    def _until_split(self) -> int:
+        while self._next_split < len(self._splits) \
+                and self._splits[self._next_split] <= self.position:
+            self._next_split += 1
+        if self._next_split < len(self._splits):
+            return self._splits[self._next_split] - self.position
+        return len(self.data) - self.position
+
+
+def split_points(data: str, dialect: csv.Dialect) -> List[int]:
+    """Returns positions inside of "\\r\\n", doubled quotechars and escape sequences."""
+    quote_pair = dialect.quotechar * 2 if dialect.quotechar else None
+    escapechar = dialect.escapechar
+    points = []
+
+    for i in range(1, len(data)):
+        pair = data[i - 1:i + 1]
+        if pair == "\r\n" or pair == quote_pair or data[i - 1] == escapechar:
+            points.append(i)
+
+    return points
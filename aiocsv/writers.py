@@ -1,30 +1,74 @@
 import csv
 import io
-from typing import Any, Iterable, Mapping, Sequence
+import os
+from typing import TYPE_CHECKING, Any, Iterable, List, Mapping, Optional, Sequence, Tuple, Union
 
-from .protocols import WithAsyncWrite
+from .dialects import resolve_dialect
+from .instrumentation import Instrumentation, WriteMeter, get_default
+from .protocols import WithAsyncWrite, WithAsyncWriteBytes
+from .serializer import Serializer, make_serializer
+
+if TYPE_CHECKING:
+    import asyncio
+    from concurrent.futures import Executor
+
+# Default amount of rows serialized at once by a single AsyncParallelWriter worker
+PARALLEL_BATCH_SIZE: int = 4096
+
+
+def _write_meter(instrumentation: Optional[Instrumentation], writer: str) -> Optional[WriteMeter]:
+    instrumentation = instrumentation or get_default()
+    if instrumentation is None:
+        return None
+    return WriteMeter(instrumentation, {"aiocsv.writer": writer})
 
 
 class AsyncWriter:
     """An object that writes csv rows to the given asynchronous file.
     In this object "row" is a sequence of values.
 
+    If `binary` is set, rows are serialized straight to UTF-8,
+    and the asyncfile has to accept bytes-like objects.
+
+    Spans and metrics are reported to `instrumentation`
+    (defaults to aiocsv.instrumentation.get_default()).
+
     Additional keyword arguments are passed to the underlying csv.writer instance.
     """
-    def __init__(self, asyncfile: WithAsyncWrite, **csvwriterparams) -> None:
+    def __init__(self, asyncfile: Union[WithAsyncWrite, WithAsyncWriteBytes], *,
+                 binary: bool = False, instrumentation: Optional[Instrumentation] = None,
+                 **csvwriterparams) -> None:
         self._file = asyncfile
         self._buffer = io.StringIO(newline="")
         self._csv_writer = csv.writer(self._buffer, **csvwriterparams)
+        self._serializer: Optional[Serializer] = \
+            make_serializer(self._csv_writer.dialect) if binary else None
+        self._meter = _write_meter(instrumentation, "AsyncWriter")
 
     @property
     def dialect(self) -> csv.Dialect:
         return self._csv_writer.dialect
 
+    async def _write(self, data: Any) -> None:
+        if self._meter is None:
+            await self._file.write(data)
+        else:
+            await self._meter.write(self._file, data)
+
     async def _rewrite_buffer(self) -> None:
         """Writes the current value of self._buffer to the actual target file.
         """
+        # Write serialized bytes to the file - copied, as the serializer's buffer
+        # is reused, and the file may keep the object it was given
+        if self._serializer is not None:
+            with self._serializer.getbuffer() as view:
+                data = bytes(view)
+            await self._write(data)
+            self._serializer.clear()
+            return
+
         # Write buffer value to the file
-        await self._file.write(self._buffer.getvalue())
+        await self._write(self._buffer.getvalue())
 
         # Clear buffer
         self._buffer.seek(0)
@@ -32,8 +76,14 @@ class AsyncWriter:
 
     async def writerow(self, row: Iterable[Any]) -> None:
         """Writes one row to the specified file."""
+        if self._meter is not None:
+            self._meter.rows += 1
+
         # Pass row to underlying csv.writer instance
-        self._csv_writer.writerow(row)
+        if self._serializer is not None:
+            self._serializer.writerow(row)
+        else:
+            self._csv_writer.writerow(row)
 
         # Write to actual file
         await self._rewrite_buffer()
@@ -43,8 +93,14 @@ class AsyncWriter:
 
         All rows are temporarly stored in RAM before actually being written to the file,
         so don't provide a generator of loads of rows."""
+        if self._meter is not None:
+            rows = self._meter.count(rows)
+
         # Pass row to underlying csv.writer instance
-        self._csv_writer.writerows(rows)
+        if self._serializer is not None:
+            self._serializer.writerows(rows)
+        else:
+            self._csv_writer.writerows(rows)
 
         # Write to actual file
         await self._rewrite_buffer()
@@ -54,22 +110,56 @@ class AsyncDictWriter:
     """An object that writes csv rows to the given asynchronous file.
     In this object "row" is a mapping from fieldnames to values.
 
+    If `binary` is set, rows are serialized straight to UTF-8,
+    and the asyncfile has to accept bytes-like objects.
+
+    `instrumentation` works exactly like in AsyncWriter.
+
     Additional keyword arguments are passed to the underlying csv.DictWriter instance.
     """
-    def __init__(self, asyncfile: WithAsyncWrite, fieldnames: Sequence[str],
+    def __init__(self, asyncfile: Union[WithAsyncWrite, WithAsyncWriteBytes],
+                 fieldnames: Sequence[str], *, binary: bool = False,
+                 instrumentation: Optional[Instrumentation] = None,
                  **csvdictwriterparams) -> None:
         self._file = asyncfile
         self._buffer = io.StringIO(newline="")
         self._csv_writer = csv.DictWriter(self._buffer, fieldnames, **csvdictwriterparams)
+        self._serializer: Optional[Serializer] = \
+            make_serializer(self._csv_writer.writer.dialect) if binary else None
+        self._meter = _write_meter(instrumentation, "AsyncDictWriter")
 
     @property
     def dialect(self) -> csv.Dialect:
         return self._csv_writer.writer.dialect
 
+    def _dict_to_list(self, row: Mapping[str, Any]) -> List[Any]:
+        """Converts a row to a list of values, exactly like csv.DictWriter does."""
+        if self._csv_writer.extrasaction == "raise":
+            wrong_fields = row.keys() - self._csv_writer.fieldnames
+            if wrong_fields:
+                raise ValueError("dict contains fields not in fieldnames: "
+                                 + ", ".join([repr(x) for x in wrong_fields]))
+        return [row.get(key, self._csv_writer.restval) for key in self._csv_writer.fieldnames]
+
+    async def _write(self, data: Any) -> None:
+        if self._meter is None:
+            await self._file.write(data)
+        else:
+            await self._meter.write(self._file, data)
+
     async def _rewrite_buffer(self) -> None:
         """Writes the current value of self._buffer to the actual target file."""
+        # Write serialized bytes to the file - copied, as the serializer's buffer
+        # is reused, and the file may keep the object it was given
+        if self._serializer is not None:
+            with self._serializer.getbuffer() as view:
+                data = bytes(view)
+            await self._write(data)
+            self._serializer.clear()
+            return
+
         # Write buffer value to the file
-        await self._file.write(self._buffer.getvalue())
+        await self._write(self._buffer.getvalue())
 
         # Clear buffer
         self._buffer.seek(0)
@@ -77,12 +167,22 @@ class AsyncDictWriter:
 
     async def writeheader(self) -> None:
         """Writes header row to the specified file."""
-        self._csv_writer.writeheader()
+        if self._meter is not None:
+            self._meter.rows += 1
+        if self._serializer is not None:
+            self._serializer.writerow(self._csv_writer.fieldnames)
+        else:
+            self._csv_writer.writeheader()
         await self._rewrite_buffer()
 
     async def writerow(self, row: Mapping[str, Any]) -> None:
         """Writes one row to the specified file."""
-        self._csv_writer.writerow(row)
+        if self._meter is not None:
+            self._meter.rows += 1
+        if self._serializer is not None:
+            self._serializer.writerow(self._dict_to_list(row))
+        else:
+            self._csv_writer.writerow(row)
         await self._rewrite_buffer()
 
     async def writerows(self, rows: Iterable[Mapping[str, Any]]) -> None:
@@ -90,5 +190,192 @@ class AsyncDictWriter:
 
         All rows are temporarly stored in RAM before actually being written to the file,
         so don't provide a generator of loads of rows."""
-        self._csv_writer.writerows(rows)
+        if self._meter is not None:
+            rows = self._meter.count(rows)
+        if self._serializer is not None:
+            self._serializer.writerows(map(self._dict_to_list, rows))
+        else:
+            self._csv_writer.writerows(rows)
         await self._rewrite_buffer()
+
+
+class AsyncParallelWriter:
+    """An object that writes csv rows to the given asynchronous file,
+    serializing batches of rows on multiple threads.
+    In this object "row" is a sequence of values.
+
+    Rows are collected into batches of `batch_size` rows, which are serialized
+    by a pool of `workers` threads (the C serializer releases the GIL while
+    escaping and encoding the values). A single writer task writes finished batches
+    to the file, in order. At most 2*workers batches are in flight at the same time.
+
+    Rows are copied (as tuples) when passed to writerow/writerows,
+    so they may be modified right after the call.
+    Call flush() (or use `async with`) to ensure all rows were written.
+    If the `async with` block raises, rows which weren't written yet are discarded.
+
+    If `binary` is set, rows are serialized straight to UTF-8,
+    and the asyncfile has to accept bytes-like objects - otherwise straight into str.
+
+    Additional keyword arguments are understood as dialect parameters.
+    """
+    def __init__(self, asyncfile: Union[WithAsyncWrite, WithAsyncWriteBytes], *,
+                 binary: bool = False, workers: Optional[int] = None,
+                 batch_size: int = PARALLEL_BATCH_SIZE,
+                 executor: Optional["Executor"] = None, **csvwriterparams) -> None:
+        # Imported here, so that importing writers doesn't import asyncio (and a lot more)
+        from concurrent.futures import ThreadPoolExecutor
+
+        self._file = asyncfile
+        self._binary = binary
+        self._dialect = resolve_dialect(**csvwriterparams)
+        self._serializer = make_serializer(self._dialect)
+
+        self.workers: int = workers or os.cpu_count() or 1
+        self.batch_size = batch_size
+
+        self._own_executor = executor is None
+        self._executor = executor or ThreadPoolExecutor(self.workers, "aiocsv-writer")
+
+        self._batch: List[Tuple[Any, ...]] = []
+        self._queue: Optional["asyncio.Queue[Optional[asyncio.Future]]"] = None
+        self._writer_task: Optional["asyncio.Task[None]"] = None
+        # Error which has stopped the writer task, re-raised on every further write
+        self._error: Optional[Exception] = None
+
+    @property
+    def dialect(self) -> csv.Dialect:
+        return self._dialect
+
+    def _serialize(self, batch: List[Tuple[Any, ...]]) -> Union[bytes, str]:
+        """Serializes a batch of rows; executed on one of the worker threads."""
+        return self._serializer.dumps(batch, text=not self._binary)
+
+    async def _write_batches(self, queue: "asyncio.Queue[Optional[asyncio.Future]]") -> None:
+        """The single writer task - writes serialized batches to the file, in order."""
+        while True:
+            future = await queue.get()
+            if future is None:
+                return
+            await self._file.write(await future)  # type: ignore
+
+    async def _check_error(self) -> None:
+        """Re-raises the error which has stopped the writer task, if there was one."""
+        if self._writer_task is not None and self._writer_task.done():
+            await self._finish_writer_task()
+        if self._error is not None:
+            raise self._error
+
+    async def _submit_batch(self) -> None:
+        import asyncio
+        await self._check_error()
+        if not self._batch:
+            return
+
+        if self._writer_task is None:
+            self._queue = asyncio.Queue(2 * self.workers)
+            self._writer_task = asyncio.ensure_future(self._write_batches(self._queue))
+
+        batch, self._batch = self._batch, []
+        future = asyncio.get_event_loop().run_in_executor(self._executor, self._serialize,
+                                                            batch)
+
+        # Wait for a free slot in the queue - unless the writer task has died
+        put = asyncio.ensure_future(self._queue.put(future))  # type: ignore
+        await asyncio.wait([put, self._writer_task], return_when=asyncio.FIRST_COMPLETED)
+
+        if not put.done():
+            put.cancel()
+            future.cancel()
+            await self._finish_writer_task()
+
+    async def _finish_writer_task(self) -> None:
+        """Waits for the writer task to exit, re-raising any errors it has encountered."""
+        task, self._writer_task = self._writer_task, None
+        queue, self._queue = self._queue, None
+
+        if task is None:
+            return
+
+        if not task.done():
+            await queue.put(None)  # type: ignore
+
+        try:
+            await task
+        except Exception as e:
+            self._error = e
+            raise
+        finally:
+            # Don't leave any serialization results un-retrieved
+            while queue is not None and not queue.empty():
+                future = queue.get_nowait()
+                if future is not None:
+                    future.cancel()
+
+    async def _cancel_writer_task(self) -> None:
+        """Stops the writer task, discarding all batches which weren't written yet."""
+        task, self._writer_task = self._writer_task, None
+        queue, self._queue = self._queue, None
+        self._batch = []
+
+        if task is None:
+            return
+
+        import asyncio
+        task.cancel()
+        await asyncio.wait([task])
+        if not task.cancelled():
+            # Retrieved, but the error which has failed the block takes precedence
+            task.exception()
+
+        while queue is not None and not queue.empty():
+            future = queue.get_nowait()
+            if future is not None:
+                future.cancel()
+
+    async def writerow(self, row: Iterable[Any]) -> None:
+        """Adds one row to the current batch, submitting the batch if it's full."""
+        if self._error is not None:
+            raise self._error
+        self._batch.append(tuple(row))
+        if len(self._batch) >= self.batch_size:
+            await self._submit_batch()
+
+    async def writerows(self, rows: Iterable[Iterable[Any]]) -> None:
+        """Adds multiple rows to the current batch, submitting every full batch.
+        Unlike AsyncWriter.writerows, this method can be used with generators
+        producing lots of rows."""
+        await self._check_error()
+        for row in rows:
+            self._batch.append(tuple(row))
+            if len(self._batch) >= self.batch_size:
+                await self._submit_batch()
+
+    async def flush(self) -> None:
+        """Waits until all rows are serialized and written to the file."""
+        await self._submit_batch()
+        await self._finish_writer_task()
+
+    async def close(self) -> None:
+        """Flushes the writer and shuts down its thread pool (unless an executor was provided).
+        """
+        try:
+            await self.flush()
+        finally:
+            if self._own_executor:
+                self._executor.shutdown(wait=False)
+
+    async def __aenter__(self) -> "AsyncParallelWriter":
+        return self
+
+    async def __aexit__(self, exc_type: Any, *_: Any) -> None:
+        if exc_type is None:
+            await self.close()
+            return
+
+        # Rows of a failed block, which weren't written yet, are discarded
+        try:
+            await self._cancel_writer_task()
+        finally:
+            if self._own_executor:
+                self._executor.shutdown(wait=False)
@@ -0,0 +1,46 @@
+"""Measures peak and retained memory (with tracemalloc) of readers and writers
+over differently shaped files:
+
+    CYTHONIZE=1 python3 setup.py build_ext --inplace
+    python3 benchmarks/memory.py --rows 20000
+
+"blocks/row" counts memory blocks allocated while reading or writing, which are still
+alive afterwards. The peak limit enforced by tests/test_memory.py is in the last column.
+"""
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "tests"))
+
+from helpers import ROW_SHAPES, measure_memory, memory_cases  # noqa: E402
+
+# Same as in tests/test_memory.py
+PEAK_PER_ROW = 64
+
+
+def main() -> None:
+    arg_parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    arg_parser.add_argument("--rows", type=int, default=20000)
+    args = arg_parser.parse_args()
+
+    print(f"{args.rows} rows per shape, peak limit {PEAK_PER_ROW} B/row")
+    print(f"{'shape':<8}{'object':<30}{'peak KiB':>10}{'peak B/row':>12}{'retained B':>12}"
+          f"{'blocks/row':>12}{'':>6}")
+
+    for shape in ROW_SHAPES:
+        for name, func in memory_cases(shape, args.rows).items():
+            footprint = measure_memory(func)
+            # writerows keeps all rows in memory by design, so it isn't limited
+            if name.endswith(".writerows"):
+                status = "-"
+            else:
+                status = "ok" if footprint.peak_per_row < PEAK_PER_ROW else "OVER"
+            print(f"{shape:<8}{name:<30}{footprint.peak / 1024:>10.1f}"
+                  f"{footprint.peak_per_row:>12.2f}{footprint.retained:>12}"
+                  f"{footprint.blocks_per_row:>12.3f}{status:>6}")
+
+
+if __name__ == "__main__":
+    main()
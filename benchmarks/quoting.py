@@ -0,0 +1,101 @@
+"""Measures the throughput of the indexer and of AsyncReader over the same rows,
+written with QUOTE_MINIMAL and QUOTE_ALL:
+
+    CYTHONIZE=1 python3 setup.py build_ext --inplace
+    python3 benchmarks/quoting.py --rows 200000
+
+Set AIOCSV_SIMD to compare the block scanning variants, e.g. AIOCSV_SIMD=sse2.
+"""
+import argparse
+import asyncio
+import csv
+import io
+import os
+import random
+import sys
+import time
+from typing import Any, Callable, List
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+
+from aiocsv import AsyncReader  # noqa: E402
+from aiocsv._parser import BufferIndex, Source, simd_variant  # noqa: E402
+
+QUOTING = {"minimal": csv.QUOTE_MINIMAL, "all": csv.QUOTE_ALL}
+
+
+def generate(rows: int) -> List[List[str]]:
+    rng = random.Random(0)
+    return [[str(i), f"name {rng.randint(0, 10**6)}",
+             'a longer text, with "quotes"' if i % 3 == 0 else "a longer plain text value",
+             f"{rng.random():.6f}"] for i in range(rows)]
+
+
+def serialize(rows: List[List[str]], quoting: int) -> str:
+    buffer = io.StringIO(newline="")
+    csv.writer(buffer, quoting=quoting).writerows(rows)
+    return buffer.getvalue()
+
+
+def index(obj: Any) -> None:
+    dialect = csv.reader("").dialect
+    source = Source(obj, "utf-8", dialect)
+    buffer_index = BufferIndex(source, dialect)
+    buffer_index.index(0, source.length)
+    buffer_index.finish()
+
+
+def count_quotes(obj: Any) -> None:
+    source = Source(obj, "utf-8", csv.reader("").dialect)
+    source.count_quotes(0, source.length, '"')
+
+
+def read(data: str) -> None:
+    class StringSource:
+        def __init__(self) -> None:
+            self.data = io.StringIO(data, newline="")
+
+        async def read(self, size: int) -> str:
+            return self.data.read(size)
+
+    async def read_all() -> None:
+        async for _ in AsyncReader(StringSource()):
+            pass
+
+    loop = asyncio.new_event_loop()
+    loop.run_until_complete(read_all())
+    loop.close()
+
+
+def measure(func: Callable[[], None], repeat: int) -> float:
+    best = float("inf")
+    for _ in range(repeat):
+        start = time.perf_counter()
+        func()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def main() -> None:
+    arg_parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    arg_parser.add_argument("--rows", type=int, default=200000)
+    arg_parser.add_argument("--repeat", type=int, default=3)
+    args = arg_parser.parse_args()
+
+    rows = generate(args.rows)
+    print(f"{args.rows} rows, best of {args.repeat}, {simd_variant()} variant")
+    print(f"{'quoting':<10}{'test':<16}{'seconds':>10}{'MB/s':>10}")
+
+    for name, quoting in QUOTING.items():
+        data = serialize(rows, quoting)
+        encoded = data.encode("utf-8")
+        for test, func in [("index str", lambda: index(data)),
+                           ("index utf-8", lambda: index(encoded)),
+                           ("count quotes", lambda: count_quotes(encoded)),
+                           ("AsyncReader", lambda: read(data))]:
+            seconds = measure(func, args.repeat)
+            print(f"{name:<10}{test:<16}{seconds:>10.3f}{len(encoded) / seconds / 1e6:>10.1f}")
+
+
+if __name__ == "__main__":
+    main()
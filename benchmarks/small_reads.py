@@ -0,0 +1,63 @@
+"""Measures how much reading slows down when the file returns short reads
+(see aiocsv.testing.AdversarialSource), compared to reads of the requested size:
+
+    CYTHONIZE=1 python3 setup.py build_ext --inplace
+    python3 benchmarks/small_reads.py --rows 20000
+"""
+import argparse
+import asyncio
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+
+from aiocsv import AsyncReader  # noqa: E402
+from aiocsv.testing import MODES, AdversarialSource  # noqa: E402
+
+
+def generate(rows: int) -> str:
+    return "".join(
+        f'{i},"quoted, ""cell"" {i}",plain {i},{i * 0.5}\r\n' for i in range(rows)
+    )
+
+
+async def read_all(data: str, mode: str, lazy: bool) -> int:
+    rows = 0
+    async for row in AsyncReader(AdversarialSource(data, mode, seed=0), lazy=lazy):
+        rows += 1
+    return rows
+
+
+def measure(data: str, mode: str, lazy: bool, repeat: int) -> float:
+    best = float("inf")
+    for _ in range(repeat):
+        loop = asyncio.new_event_loop()
+        start = time.perf_counter()
+        loop.run_until_complete(read_all(data, mode, lazy))
+        best = min(best, time.perf_counter() - start)
+        loop.close()
+    return best
+
+
+def main() -> None:
+    arg_parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    arg_parser.add_argument("--rows", type=int, default=20000)
+    arg_parser.add_argument("--repeat", type=int, default=3)
+    args = arg_parser.parse_args()
+
+    data = generate(args.rows)
+    print(f"{args.rows} rows, {len(data)} chars, best of {args.repeat}")
+    print(f"{'reader':<8}{'mode':<8}{'seconds':>10}{'Mchars/s':>10}{'slowdown':>10}")
+
+    for lazy in (False, True):
+        baseline = 0.0
+        for mode in MODES:
+            seconds = measure(data, mode, lazy, args.repeat)
+            baseline = baseline or seconds
+            print(f"{'lazy' if lazy else 'eager':<8}{mode:<8}{seconds:>10.3f}"
+                  f"{len(data) / seconds / 1e6:>10.2f}{seconds / baseline:>9.1f}x")
+
+
+if __name__ == "__main__":
+    main()
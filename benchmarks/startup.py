@@ -0,0 +1,103 @@
+"""Measures the startup cost of short-lived programs: importing aiocsv and creating
+(and using) the first reader, each in a fresh interpreter - and creating further readers:
+
+    CYTHONIZE=1 python3 setup.py build_ext --inplace
+    python3 benchmarks/startup.py --repeat 20
+
+Steps are measured one after another, so every step only includes what wasn't already
+imported by the previous ones. asyncio and csv are imported before aiocsv, as programs
+using aiocsv import them anyway.
+"""
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import timeit
+import warnings
+
+ROOT = os.path.join(os.path.dirname(__file__), "..")
+
+sys.path.insert(0, ROOT)
+
+# Run in a fresh interpreter, prints the duration of every step as JSON
+STEPS = """
+import json, time
+times = {}
+start = time.perf_counter()
+import asyncio, csv
+times["import asyncio, csv"] = time.perf_counter() - start
+
+start = time.perf_counter()
+import aiocsv
+times["import aiocsv"] = time.perf_counter() - start
+
+start = time.perf_counter()
+from aiocsv import AsyncReader
+times["from aiocsv import AsyncReader"] = time.perf_counter() - start
+
+class Source:
+    def __init__(self):
+        self.data = "a,b,c\\r\\n1,2,3\\r\\n"
+    async def read(self, size):
+        data, self.data = self.data, ""
+        return data
+
+start = time.perf_counter()
+reader = AsyncReader(Source())
+times["first AsyncReader()"] = time.perf_counter() - start
+
+async def read_all():
+    return [row async for row in reader]
+
+loop = asyncio.new_event_loop()
+start = time.perf_counter()
+loop.run_until_complete(read_all())
+times["first rows"] = time.perf_counter() - start
+print(json.dumps(times))
+"""
+
+
+def measure_fresh(repeat: int) -> dict:
+    runs = []
+    for _ in range(repeat):
+        output = subprocess.run([sys.executable, "-c", STEPS], cwd=ROOT, check=True,
+                                stdout=subprocess.PIPE, universal_newlines=True).stdout
+        runs.append(json.loads(output))
+    return {step: statistics.median(run[step] for run in runs) for step in runs[0]}
+
+
+def measure_readers(number: int) -> dict:
+    import io
+    from aiocsv import AsyncReader
+
+    # The readers are never iterated over
+    warnings.simplefilter("ignore", RuntimeWarning)
+    source = io.StringIO()
+    results = {}
+    for label, params in [("AsyncReader()", {}), ("AsyncReader(delimiter=';')",
+                                                  {"delimiter": ";"})]:
+        seconds = min(timeit.repeat(lambda: AsyncReader(source, **params), number=number,
+                                    repeat=3))
+        results[label] = seconds / number
+    return results
+
+
+def main() -> None:
+    arg_parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    arg_parser.add_argument("--repeat", type=int, default=20)
+    arg_parser.add_argument("--number", type=int, default=20000)
+    args = arg_parser.parse_args()
+
+    print(f"fresh interpreters, median of {args.repeat}")
+    for step, seconds in measure_fresh(args.repeat).items():
+        print(f"{step:<34}{seconds * 1e3:>10.2f} ms")
+
+    print(f"\nfurther readers, best of 3x{args.number}")
+    for label, seconds in measure_readers(args.number).items():
+        print(f"{label:<34}{seconds * 1e6:>10.2f} µs")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,53 @@
+"""libFuzzer entry point, checking that the Cython parser, the pure-Python parser
+and csv.reader agree on arbitrary inputs. Requires atheris and a build of the C extension
+(ideally instrumented, see https://github.com/google/atheris#native-extensions):
+
+    CYTHONIZE=1 python3 setup.py build_ext --inplace
+    python3 fuzz/fuzz_parser.py -max_len=256
+"""
+import csv
+import os
+import sys
+
+import atheris
+
+with atheris.instrument_imports():
+    sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "tests"))
+    from test_fuzz import check_agreement
+
+DELIMITERS = [",", ";", "\t", "|"]
+QUOTECHARS = ['"', "'", None]
+ESCAPECHARS = [None, "\\", "$"]
+QUOTINGS = [csv.QUOTE_MINIMAL, csv.QUOTE_ALL, csv.QUOTE_NONNUMERIC, csv.QUOTE_NONE]
+NEWLINES = [None, "\n", "\r\n"]
+
+
+def test_one_input(data: bytes) -> None:
+    fdp = atheris.FuzzedDataProvider(data)
+    quotechar = fdp.PickValueInList(QUOTECHARS)
+    params = {
+        "delimiter": fdp.PickValueInList(DELIMITERS),
+        "quotechar": quotechar,
+        "escapechar": fdp.PickValueInList(ESCAPECHARS),
+        "quoting": fdp.PickValueInList(QUOTINGS) if quotechar is not None else csv.QUOTE_NONE,
+        "doublequote": fdp.ConsumeBool(),
+        "skipinitialspace": fdp.ConsumeBool(),
+        "strict": fdp.ConsumeBool(),
+    }
+    newline = fdp.PickValueInList(NEWLINES)
+    chunks = [fdp.ConsumeIntInRange(1, 8) for _ in range(fdp.ConsumeIntInRange(0, 4))]
+    text = fdp.ConsumeUnicodeNoSurrogates(fdp.remaining_bytes()).replace("\0", "")
+
+    # Stray line breaks are regular data with strict line terminators (see tests/test_fuzz.py)
+    if newline is not None:
+        text = text.replace("\r\n", "\0").replace("\r", "").replace("\n", "")
+        text = text.replace("\0", newline)
+    if newline == "\r\n" and params["escapechar"] and params["escapechar"] + "\r\n" in text:
+        return
+
+    check_agreement(text, params, newline, chunks)
+
+
+if __name__ == "__main__":
+    atheris.Setup(sys.argv, test_one_input)
+    atheris.Fuzz()
@@ -3,6 +3,8 @@ from setuptools.extension import Extension
 from os import getenv
 
 # new release walkthrough:
+# CYTHONIZE=1 python3 setup.py build_ext --inplace
+#   (regenerates aiocsv/*.c; use Cython 0.29 - newer versions generate code requiring Python 3.9+)
 # python3 -m pytest
 # bump __version__
 # python3 setup.py sdist bdist_wheel
@@ -10,13 +12,20 @@ from os import getenv
 
 if getenv("CYTHONIZE"):
     from Cython.Build import cythonize
-    extensions = cythonize("aiocsv/_parser.pyx", language_level=3)
+    extensions = cythonize(["aiocsv/_parser.pyx", "aiocsv/_serializer.pyx"], language_level=3)
 
 else:
-    extensions = [Extension(
-        name="aiocsv._parser",
-        sources=["aiocsv/_parser.c"]
-    )]
+    extensions = [
+        Extension(
+            name="aiocsv._parser",
+            sources=["aiocsv/_parser.c"],
+            depends=["aiocsv/_clock.h", "aiocsv/_scan.h", "aiocsv/_scan_kernels.h"],
+        ),
+        Extension(
+            name="aiocsv._serializer",
+            sources=["aiocsv/_serializer.c"]
+        ),
+    ]
 
 
 with open("readme.md", "r", encoding="utf-8") as f:
@@ -0,0 +1,14 @@
+from typing import Any, List, Tuple
+import pytest
+
+
+@pytest.fixture(params=["indexed", "rows"])
+def implementation(request: pytest.FixtureRequest, monkeypatch: pytest.MonkeyPatch) -> str:
+    """Runs the test with the C implementation of a feature ("indexed"), and with its
+    pure-Python fallback ("rows") - by setting every (module, name) pair listed in
+    the test module's PURE_PYTHON to None, as if the C extension was missing."""
+    if request.param == "rows":
+        pure_python: List[Tuple[Any, str]] = request.module.PURE_PYTHON
+        for module, name in pure_python:
+            monkeypatch.setattr(module, name, None)
+    return request.param
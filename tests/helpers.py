@@ -0,0 +1,147 @@
+"""Helpers shared by the tests, and by benchmarks/memory.py"""
+import asyncio
+import csv
+import gc
+import io
+import tracemalloc
+from typing import (Any, Awaitable, Callable, Dict, Iterable, Iterator, List, NamedTuple,
+                    Union)
+
+from aiocsv import AsyncDictReader, AsyncDictWriter, AsyncReader, AsyncWriter, transform
+from aiocsv.testing import AdversarialSource
+
+
+class AsyncSink:
+    """WithAsyncWrite (and WithAsyncWriteBytes) recording every write in `writes` -
+    unless `keep` is False, then only `written` (the total length) is counted.
+    The written objects are kept as they are, so reused buffers show up as corrupted data."""
+    def __init__(self, keep: bool = True) -> None:
+        self.keep = keep
+        self.writes: List[Union[str, bytes]] = []
+        self.written = 0
+
+    async def write(self, data: Union[str, bytes]) -> None:
+        if self.keep:
+            self.writes.append(data)
+        self.written += len(data)
+
+    def getvalue(self) -> Union[str, bytes]:
+        """Returns all the written data, joined"""
+        if self.writes and not isinstance(self.writes[0], str):
+            return b"".join(self.writes)  # type: ignore
+        return "".join(self.writes)  # type: ignore
+
+
+def rows_to_csv(rows: Iterable[Iterable[Any]], **params: Any) -> str:
+    """Returns the rows, as written by csv.writer with the given dialect parameters."""
+    buffer = io.StringIO(newline="")
+    csv.writer(buffer, **params).writerows(rows)
+    return buffer.getvalue()
+
+
+# Rows of different shapes, for measuring readers and writers
+ROW_SHAPES: Dict[str, Callable[[int], List[str]]] = {
+    "narrow": lambda i: [str(i), f"name {i}", str(i * 0.5)],
+    "wide": lambda i: [f"{i}-{j}" for j in range(50)],
+    "quoted": lambda i: [str(i), f'quoted, "cell"\r\nwith a line break {i}', "plain"],
+    "long": lambda i: [str(i), "x" * 2000],
+}
+
+
+def generate_csv(shape: str, rows: int) -> str:
+    """Returns `rows` rows of the given ROW_SHAPES shape, written by csv.writer."""
+    return rows_to_csv(ROW_SHAPES[shape](i) for i in range(rows))
+
+
+class MemoryFootprint(NamedTuple):
+    rows: int
+    # Peak and retained bytes, above the memory in use before the measured code started
+    peak: int
+    retained: int
+    # Memory blocks allocated by the measured code, which are still alive after it finished
+    blocks: int
+
+    @property
+    def peak_per_row(self) -> float:
+        return self.peak / self.rows
+
+    @property
+    def retained_per_row(self) -> float:
+        return self.retained / self.rows
+
+    @property
+    def blocks_per_row(self) -> float:
+        return self.blocks / self.rows
+
+
+def measure_memory(func: Callable[[], Awaitable[int]]) -> MemoryFootprint:
+    """Runs the coroutine returned by `func` on a new event loop, tracing it with
+    tracemalloc. The coroutine returns the number of processed rows."""
+    gc.collect()
+    loop = asyncio.new_event_loop()
+    # Only what's allocated after tracing starts is counted
+    tracemalloc.start()
+    try:
+        ignore = [tracemalloc.Filter(False, tracemalloc.__file__)]
+        before = tracemalloc.take_snapshot().filter_traces(ignore)
+        base = tracemalloc.get_traced_memory()[0]
+        rows = loop.run_until_complete(func())
+        gc.collect()
+        current, peak = tracemalloc.get_traced_memory()
+        after = tracemalloc.take_snapshot().filter_traces(ignore)
+    finally:
+        tracemalloc.stop()
+        loop.close()
+
+    blocks = sum(stat.count_diff for stat in after.compare_to(before, "filename"))
+    return MemoryFootprint(rows, peak - base, current - base, blocks)
+
+
+def memory_cases(shape: str, rows: int) -> Dict[str, Callable[[], Awaitable[int]]]:
+    """Returns coroutine functions for measure_memory, reading or writing `rows` rows
+    of the given ROW_SHAPES shape with every reader and writer. AsyncWriter.writerows
+    and AsyncDictWriter.writerows keep all the serialized rows in memory by design."""
+    data = generate_csv(shape, rows)
+    fieldnames = list(map(str, range(len(ROW_SHAPES[shape](0)))))
+
+    def source() -> AdversarialSource:
+        return AdversarialSource(data, "exact")
+
+    async def count(reader: Any, header: int = 0) -> int:
+        n = header
+        async for _ in reader:
+            n += 1
+        return n
+
+    def generate_rows() -> Iterator[List[str]]:
+        return (ROW_SHAPES[shape](i) for i in range(rows))
+
+    def generate_dicts() -> Iterator[Dict[str, str]]:
+        return (dict(zip(fieldnames, row)) for row in generate_rows())
+
+    async def writerow(writer: Any, rows_iter: Iterator[Any]) -> int:
+        for row in rows_iter:
+            await writer.writerow(row)
+        return rows
+
+    async def writerows(writer: Any, rows_iter: Iterator[Any]) -> int:
+        await writer.writerows(rows_iter)
+        return rows
+
+    def sink() -> AsyncSink:
+        return AsyncSink(keep=False)
+
+    return {
+        "AsyncReader": lambda: count(AsyncReader(source())),
+        "AsyncReader(lazy)": lambda: count(AsyncReader(source(), lazy=True)),
+        "AsyncDictReader": lambda: count(AsyncDictReader(source()), header=1),
+        "transform": lambda: transform(source(), sink(), dialect_out="excel-tab"),
+        "AsyncWriter.writerow": lambda: writerow(AsyncWriter(sink()), generate_rows()),
+        "AsyncWriter.writerow(binary)":
+            lambda: writerow(AsyncWriter(sink(), binary=True), generate_rows()),
+        "AsyncDictWriter.writerow":
+            lambda: writerow(AsyncDictWriter(sink(), fieldnames), generate_dicts()),
+        "AsyncWriter.writerows": lambda: writerows(AsyncWriter(sink()), generate_rows()),
+        "AsyncDictWriter.writerows":
+            lambda: writerows(AsyncDictWriter(sink(), fieldnames), generate_dicts()),
+    }
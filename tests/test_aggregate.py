@@ -0,0 +1,135 @@
+from typing import Any, Dict, List, Optional, Sequence, Tuple
+import csv
+import math
+import random
+import pytest
+
+from aiocsv import aggregate, aggregation
+from aiocsv.testing import AdversarialSource
+from helpers import rows_to_csv
+
+# Disabled for the pure-Python implementation (see conftest.py)
+PURE_PYTHON = [(aggregation, "Aggregator")]
+
+AGGREGATES: Dict[str, Tuple[str, Optional[int]]] = {
+    "rows": ("count", None),
+    "total": ("sum", 2),
+    "lowest": ("min", 2),
+    "highest": ("max", 3),
+    "average": ("mean", 3),
+}
+
+KEYS = ["a", "b", '"quoted", key', "zażółć", "🦀", "multi\r\nline", ""]
+
+
+def generate_rows(count: int) -> List[List[str]]:
+    rng = random.Random(0)
+    rows = []
+    for i in range(count):
+        row = [rng.choice(KEYS), rng.choice("xy"), str(rng.randint(-100, 100)),
+               rng.choice([f"{rng.random() * 1000:.3f}", "", "1e3", " 7 "])]
+        rows.append(row[:rng.choice([4, 4, 4, 1])])
+    return rows
+
+
+ROWS = generate_rows(5000)
+
+
+def expected(rows: List[List[Any]], key_columns: Sequence[int],
+             aggregates: Dict[str, Tuple[str, Optional[int]]]) -> Dict[Any, Dict[str, Any]]:
+    groups: Dict[Any, List[List[Any]]] = {}
+    for row in rows:
+        if row:
+            groups.setdefault(tuple(row[i] if i < len(row) else "" for i in key_columns),
+                              []).append(row)
+
+    result: Dict[Any, Dict[str, Any]] = {}
+    for key, group in groups.items():
+        result[key] = {}
+        for name, (function, column) in aggregates.items():
+            assert column is not None or function == "count"
+            values = [float(r[column]) for r in group
+                      if column is not None and column < len(r) and r[column] != ""]
+            if function == "count":
+                result[key][name] = len(group)
+            elif function == "sum":
+                result[key][name] = pytest.approx(math.fsum(values), rel=1e-12)
+            elif not values:
+                result[key][name] = None
+            elif function == "mean":
+                result[key][name] = pytest.approx(math.fsum(values) / len(values), rel=1e-12)
+            else:
+                result[key][name] = min(values) if function == "min" else max(values)
+    return result
+
+
+async def run_aggregate(data: str, mode: str = "exact",
+                        **kwargs: Any) -> Dict[Any, Dict[str, Any]]:
+    return await aggregate(AdversarialSource(data, mode, seed=0), **kwargs)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", ["exact", "random"])
+@pytest.mark.parametrize("key_columns", [[0], [1, 0], []], ids=["single", "multi", "total"])
+async def test_aggregate_matches_python(implementation: str, mode: str,
+                                        key_columns: List[int]):
+    header = ["key", "letter", "int", "float"]
+    result = await run_aggregate(rows_to_csv([header] + ROWS), mode, key_columns=key_columns,
+                                 aggregates=AGGREGATES, header=True)
+
+    assert result == expected(ROWS, key_columns, AGGREGATES)
+    assert list(result) == list(expected(ROWS, key_columns, AGGREGATES))
+
+
+@pytest.mark.asyncio
+async def test_aggregate_many_groups(implementation: str):
+    rows = [[f"key {i % 20000}", str(i)] for i in range(50000)]
+    aggregates: Dict[str, Tuple[str, Optional[int]]] = {"n": ("count", None),
+                                                         "max": ("max", 1)}
+    result = await run_aggregate(rows_to_csv(rows), key_columns=[0], aggregates=aggregates)
+    assert result == expected(rows, [0], aggregates)
+
+
+@pytest.mark.asyncio
+async def test_aggregate_numbers(implementation: str):
+    # Everything float() accepts, including what's converted without the fast path
+    values = ["1", "-2.5", " 3 ", "1_000", "1e999", "-inf", "١٢", "4E-2", "9" * 100]
+    rows = [["k", v] for v in values]
+    aggregates: Dict[str, Tuple[str, Optional[int]]] = {"min": ("min", 1), "max": ("max", 1)}
+    result = await run_aggregate(rows_to_csv(rows), key_columns=[0], aggregates=aggregates)
+    assert result == {("k",): {"min": -math.inf, "max": math.inf}}
+
+    result = await run_aggregate(rows_to_csv(rows[:4] + rows[6:]), key_columns=[],
+                                 aggregates={"sum": ("sum", 1)})
+    total = sum(float(v) for v in values[:4] + values[6:])
+    assert result == {(): {"sum": pytest.approx(total)}}
+
+    with pytest.raises(ValueError):
+        await run_aggregate("k,1\r\nk,x\r\n", key_columns=[0], aggregates={"sum": ("sum", 1)})
+
+
+@pytest.mark.asyncio
+async def test_aggregate_nonnumeric_dialect(implementation: str):
+    rows = [[1, "a", 2.5], [1.0, "b", ""], ["1", "c", -1]]
+    dialect = csv.reader("", quoting=csv.QUOTE_NONNUMERIC).dialect
+    result = await run_aggregate(rows_to_csv(rows, quoting=csv.QUOTE_NONNUMERIC), key_columns=[0],
+                                 aggregates={"n": ("count", None), "sum": ("sum", 2)},
+                                 dialect=dialect)
+    assert result == {(1.0,): {"n": 2, "sum": 2.5}, ("1",): {"n": 1, "sum": -1.0}}
+
+
+@pytest.mark.asyncio
+async def test_aggregate_errors(implementation: str):
+    for key_columns, aggregates in [
+        ([-1], {"n": ("count", None)}),
+        ([0], {"n": ("median", 1)}),
+        ([0], {"n": ("sum", None)}),
+        ([0], {"n": ("max", -2)}),
+    ]:
+        with pytest.raises(ValueError):
+            await run_aggregate("a,1\r\n", key_columns=key_columns, aggregates=aggregates)
+
+    with pytest.raises(csv.Error):
+        await run_aggregate('a,1\r\n"b"c,2\r\n', key_columns=[0],
+                            aggregates={"n": ("count", None)},
+                            dialect=csv.reader("", strict=True).dialect)
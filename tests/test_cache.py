@@ -0,0 +1,164 @@
+from typing import Any, List
+import csv
+import io
+import os
+import random
+import sys
+import pytest
+
+from aiocsv import AsyncReader
+from aiocsv import cache as cache_module
+
+# Without the C extension, cache_dir is ignored
+pytest.importorskip("aiocsv._parser")
+
+KEYS = ["a", "b", '"quoted", key', "zażółć", "🦀", "multi\r\nline", ""]
+
+
+def generate_rows(count: int) -> List[List[str]]:
+    rng = random.Random(0)
+    return [[rng.choice(KEYS), str(rng.randint(0, 30)), f"row {i}"][:rng.choice([3, 3, 3, 1])]
+            for i in range(count)]
+
+
+ROWS = generate_rows(3000)
+
+
+def write_csv(path: Any, rows: List[List[Any]], **params: Any) -> None:
+    buffer = io.StringIO(newline="")
+    csv.writer(buffer, **params).writerows(rows)
+    with open(path, "w", encoding="utf-8", newline="") as f:
+        f.write(buffer.getvalue())
+
+
+async def read_all(path: Any, cache_dir: Any, **kwargs: Any) -> List[List[Any]]:
+    reader = AsyncReader.from_path(str(path), cache_dir=str(cache_dir),
+                                   encoding="utf-8", **kwargs)
+    return [row async for row in reader]
+
+
+@pytest.mark.asyncio
+async def test_cache_hit(tmp_path, monkeypatch: pytest.MonkeyPatch):
+    path = tmp_path / "data.csv"
+    write_csv(path, ROWS)
+    assert await read_all(path, tmp_path / "cache") == ROWS
+    assert len(os.listdir(tmp_path / "cache")) == 1
+
+    # The second read doesn't touch the file
+    monkeypatch.setattr("aiocsv.streams.open", None, raising=False)
+    assert await read_all(path, tmp_path / "cache") == ROWS
+
+
+@pytest.mark.asyncio
+async def test_cache_invalidated(tmp_path):
+    path = tmp_path / "data.csv"
+    write_csv(path, ROWS[:100])
+    assert await read_all(path, tmp_path) == ROWS[:100]
+
+    # Same size, different mtime
+    write_csv(path, [["x" * len(row[0])] + row[1:] for row in ROWS[:100]])
+    os.utime(path, ns=(0, 0))
+    assert (await read_all(path, tmp_path))[0][0] == "x" * len(ROWS[0][0])
+
+    write_csv(path, ROWS[:50])
+    assert await read_all(path, tmp_path) == ROWS[:50]
+
+    # Replaced by a file of the same size and mtime
+    other = tmp_path / "other.csv"
+    write_csv(other, [["y" * len(row[0])] + row[1:] for row in ROWS[:50]])
+    os.utime(other, ns=(0, path.stat().st_mtime_ns))
+    os.replace(other, path)
+    assert (await read_all(path, tmp_path))[0][0] == "y" * len(ROWS[0][0])
+
+    # Stale cache files are replaced
+    assert len([i for i in os.listdir(tmp_path) if i.endswith(".csvcache")]) == 1
+
+    # Different dialect
+    with open(path, newline="") as f:
+        expected = list(csv.reader(f, delimiter=";"))
+    assert await read_all(path, tmp_path, delimiter=";") == expected
+
+
+@pytest.mark.asyncio
+async def test_cache_atime(tmp_path, monkeypatch: pytest.MonkeyPatch):
+    path = tmp_path / "data.csv"
+    write_csv(path, ROWS)
+    os.utime(path, ns=(0, path.stat().st_mtime_ns))
+    add = cache_module._CacheWriter.add
+
+    # Reading the file may update its atime (e.g. on relatime mounts)
+    def add_and_access(writer: Any, index: Any) -> None:
+        add(writer, index)
+        os.utime(path, ns=(path.stat().st_atime_ns + 10**9, path.stat().st_mtime_ns))
+
+    monkeypatch.setattr(cache_module._CacheWriter, "add", add_and_access)
+    assert await read_all(path, tmp_path / "cache") == ROWS
+    assert len(os.listdir(tmp_path / "cache")) == 1
+
+
+@pytest.mark.asyncio
+async def test_cache_corrupt(tmp_path):
+    path = tmp_path / "data.csv"
+    cache = tmp_path / "cache"
+    write_csv(path, ROWS[:200])
+    await read_all(path, cache)
+    cache_file = cache / os.listdir(cache)[0]
+
+    data = bytearray(cache_file.read_bytes())
+    for corrupt in [data[:len(data) // 2], data[:-8] + b"\x7f" * 8, b"", b"garbage" * 100]:
+        cache_file.write_bytes(corrupt)
+        assert await read_all(path, cache) == ROWS[:200]
+
+    # Field ends pointing out of the heap
+    heap_start, heap_len, rows_start, rows_len, fields_len, _ = cache_module._TRAILER.unpack(
+        data[-cache_module._TRAILER.size:])
+    fields_start = rows_start + 8 * rows_len
+    data[fields_start:fields_start + 8] = (1 << 40).to_bytes(8, sys.byteorder)
+    cache_file.write_bytes(data)
+    assert await read_all(path, cache) == ROWS[:200]
+
+    # Lengths in the trailer so large that offsets computed from them overflow
+    # (a buffer of zeros passes all other checks)
+    for lengths in [(1 << 61, 0), (0, (1 << 63) // 9 + 1)]:
+        trailer = cache_module._TRAILER.pack(heap_start, heap_len, rows_start, *lengths,
+                                             cache_module.CACHE_MAGIC)
+        cache_file.write_bytes(data[:-len(trailer)] + trailer)
+        assert await read_all(path, cache) == ROWS[:200]
+        # Rejected before any ends are read
+        with pytest.raises(ValueError, match="layout"):
+            cache_module.CachedRows(bytes(64), 0, 0, 0, *lengths)
+
+
+@pytest.mark.asyncio
+async def test_cache_views_and_nonnumeric(tmp_path):
+    path = tmp_path / "data.csv"
+    rows = [["a", 1.5, 2], ["b", -3, "4"], ["c"]]
+    write_csv(path, rows, quoting=csv.QUOTE_NONNUMERIC)
+    expected = [["a", 1.5, 2.0], ["b", -3.0, "4"], ["c"]]
+
+    for _ in range(2):
+        assert await read_all(path, tmp_path, quoting=csv.QUOTE_NONNUMERIC) == expected
+
+    for _ in range(2):
+        rows = await read_all(path, tmp_path, views=True, quoting=csv.QUOTE_NONNUMERIC)
+        assert [[bytes(f).decode() for f in row] for row in rows] \
+            == [["a", "1.5", "2"], ["b", "-3", "4"], ["c"]]
+
+
+@pytest.mark.asyncio
+async def test_cache_errors(tmp_path):
+    path = tmp_path / "data.csv"
+    write_csv(path, ROWS[:10])
+    for kwargs in [{"lazy": True}, {"newline": "\n"}, {"distinct": [0]}]:
+        with pytest.raises(ValueError):
+            AsyncReader.from_path(str(path), cache_dir=str(tmp_path), **kwargs)
+
+    # Nothing is cached if the file is invalid
+    path.write_text('a,"b"c\r\n')
+    with pytest.raises(csv.Error):
+        await read_all(path, tmp_path / "cache", strict=True)
+    assert os.listdir(tmp_path / "cache") == []
+
+    # Without the cache, from_path just reads the file
+    reader = AsyncReader.from_path(str(path))
+    assert [row async for row in reader] == [["a", "bc"]]
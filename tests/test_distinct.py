@@ -0,0 +1,115 @@
+from typing import Any, Iterator, List
+import csv
+import importlib
+import random
+import sys
+import warnings
+import pytest
+
+from aiocsv import AsyncReader, readers
+from aiocsv.testing import AdversarialSource
+from helpers import rows_to_csv
+
+_parser = pytest.importorskip("aiocsv._parser")
+
+KEYS = ["a", "b", '"quoted", key', "zażółć", "🦀", "multi\r\nline", ""]
+
+
+def generate_rows(count: int) -> List[List[str]]:
+    rng = random.Random(0)
+    return [[rng.choice(KEYS), str(rng.randint(0, 30)), f"row {i}"][:rng.choice([3, 3, 3, 1])]
+            for i in range(count)]
+
+
+ROWS = generate_rows(3000)
+DATA = rows_to_csv(ROWS)
+
+
+def expected_distinct(rows: List[List[Any]], columns: List[int]) -> List[List[Any]]:
+    seen = set()
+    result = []
+    for row in rows:
+        key = tuple(row[i] if i < len(row) else "" for i in columns)
+        if not row or key not in seen:
+            seen.add(key)
+            result.append(row)
+    return result
+
+
+@pytest.fixture(params=["c", "python"])
+def implementation(request: pytest.FixtureRequest) -> Iterator[str]:
+    if request.param == "python":
+        # Reload the readers without the C extension
+        sys.modules["aiocsv._parser"] = None  # type: ignore
+        try:
+            # The first reader warns about the pure-python parser
+            with warnings.catch_warnings():
+                warnings.simplefilter("ignore")
+                importlib.reload(readers)
+                yield request.param
+        finally:
+            del sys.modules["aiocsv._parser"]
+            importlib.reload(readers)
+    else:
+        yield request.param
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("exact", [False, True], ids=["hashes", "exact"])
+@pytest.mark.parametrize("columns", [[0], [1, 0], [2]], ids=["single", "multi", "unique"])
+@pytest.mark.parametrize("mode", ["exact", "random"])
+async def test_distinct(implementation: str, exact: bool, columns: List[int], mode: str):
+    reader = readers.AsyncReader(AdversarialSource(DATA, mode, seed=3), distinct=columns,
+                                 distinct_exact=exact)
+    rows = [row async for row in reader]
+    assert rows == expected_distinct(ROWS, columns)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("lazy", [False, True], ids=["lists", "lazy"])
+async def test_distinct_lazy_and_views(implementation: str, lazy: bool):
+    reader = readers.AsyncReader(AdversarialSource(DATA, "random"), distinct=[1], lazy=lazy,
+                                 views=not lazy)
+    rows = [row async for row in reader]
+    expected = expected_distinct(ROWS, [1])
+
+    if lazy:
+        assert [list(row) for row in rows] == expected
+    else:
+        assert [[bytes(f).decode("utf-8") for f in row] for row in rows] == expected
+
+
+@pytest.mark.asyncio
+async def test_distinct_batches_and_errors():
+    reader = AsyncReader(AdversarialSource(DATA, "exact"), distinct=[0])
+    batches = []
+    while True:
+        batch = await reader.readbatch(100)
+        if not batch:
+            break
+        batches.extend(batch)
+    assert batches == expected_distinct(ROWS, [0])
+
+    with pytest.raises(ValueError):
+        AsyncReader(AdversarialSource(DATA, "exact"), distinct=[0], newline="\n")
+    with pytest.raises(ValueError):
+        AsyncReader(AdversarialSource(DATA, "exact"), distinct=[-1])
+
+
+@pytest.mark.parametrize("exact", [False, True], ids=["hashes", "exact"])
+def test_distinct_filter(exact: bool):
+    distinct = _parser.DistinctFilter([0], exact)
+    dialect = csv.reader("").dialect
+
+    for chunk, expected in [
+        ("a,1\r\nb,2\r\n\r\na,3\r\n", [["a", "1"], ["b", "2"]]),
+        ('c\r\n"a",4\r\n', [["c"]]),
+        ("b\r\nd\r\n", [["d"]]),
+    ]:
+        index = _parser.BufferIndex(_parser.Source(chunk, "utf-8", dialect), dialect)
+        index.index(0, len(chunk))
+        index.finish()
+        assert index.materialize(rows=distinct.select(index)) == expected
+
+    assert len(distinct) == 4
+    assert distinct.nbytes > 0
@@ -0,0 +1,155 @@
+"""Differential fuzzing of the Cython parser, the pure-Python parser and csv.reader.
+
+`check_agreement` is also used by the libFuzzer entry point in fuzz/fuzz_parser.py.
+"""
+from typing import Any, Dict, List, Optional
+import asyncio
+import csv
+import io
+import pytest
+
+from aiocsv import AsyncReader, parse_buffer
+from aiocsv._parser import parser as fast_parser
+from aiocsv.parser import parser as py_parser
+
+hypothesis = pytest.importorskip("hypothesis")
+st = hypothesis.strategies
+
+TOKENS = ["a", "b", "ł", "🦀", "1", "2.5", ".", "-", " ", ",", ";", "\t", "|", '"', "'", "\\",
+          "$"]
+NEWLINES = {None: ["\r", "\n", "\r\n"], "\n": ["\n"], "\r\n": ["\r\n"]}
+
+
+class ChunkedSource:
+    """WithAsyncRead returning chunks of the given sizes (cycled), regardless of
+    the requested size"""
+    def __init__(self, data: str, chunks: List[int]) -> None:
+        self.data = data
+        self.chunks = chunks or [len(data) or 1]
+        self.reads = 0
+
+    async def read(self, _: int) -> str:
+        size = self.chunks[self.reads % len(self.chunks)]
+        self.reads += 1
+        chunk, self.data = self.data[:size], self.data[size:]
+        return chunk
+
+
+def outcome(rows: Any) -> Any:
+    return [list(row) for row in rows]
+
+
+async def async_outcome(coro: Any) -> Any:
+    """Returns the parsed rows, or the type of the raised csv.Error/ValueError"""
+    try:
+        return outcome(await coro)
+    except (csv.Error, ValueError) as e:
+        return type(e)
+
+
+async def collect(rows: Any) -> List[Any]:
+    return [row async for row in rows]
+
+
+def expected_rows(text: str, params: Dict[str, Any], newline: Optional[str]) -> Any:
+    try:
+        rows = list(csv.reader(io.StringIO(text, newline=""), **params))
+    except (csv.Error, ValueError) as e:
+        return type(e)
+
+    # With any line terminator, blank lines (apart from the first one) are merged
+    # into the line terminator before them
+    if newline is None:
+        rows = [row for i, row in enumerate(rows) if row or i == 0]
+    return rows
+
+
+async def parse_all(text: str, params: Dict[str, Any], newline: Optional[str],
+                    chunks: List[int]) -> Dict[str, Any]:
+    dialect = csv.reader("", **params).dialect
+    results = {
+        name: await async_outcome(collect(parser(ChunkedSource(text, chunks), dialect,
+                                                 newline=newline)))
+        for name, parser in (("fast", fast_parser), ("python", py_parser))
+    }
+
+    # Those don't support strict line terminators
+    if newline is None:
+        results["lazy"] = await async_outcome(
+            collect(AsyncReader(ChunkedSource(text, chunks), lazy=True, **params)))
+        results["buffer"] = await async_outcome(parse_buffer(text, **params))
+        results["buffer_utf8"] = await async_outcome(parse_buffer(text.encode("utf-8"),
+                                                                  **params))
+
+    return results
+
+
+def check_agreement(text: str, params: Dict[str, Any], newline: Optional[str],
+                    chunks: List[int]) -> None:
+    """Asserts that all parsers return the same rows (or raise the same errors) as csv.reader."""
+    expected = expected_rows(text, params, newline)
+    loop = asyncio.new_event_loop()
+    try:
+        results = loop.run_until_complete(parse_all(text, params, newline, chunks))
+    finally:
+        loop.close()
+
+    for name, result in results.items():
+        if name in ("fast", "python") or not isinstance(expected, type):
+            assert result == expected, name
+        else:
+            # Indexing parsers may find a csv.Error before converting an earlier
+            # QUOTE_NONNUMERIC field
+            assert isinstance(result, type), name
+
+
+@st.composite
+def dialects(draw: Any) -> Dict[str, Any]:
+    quotechar = draw(st.sampled_from(['"', "'", None]))
+    quoting = draw(st.sampled_from([csv.QUOTE_MINIMAL, csv.QUOTE_ALL, csv.QUOTE_NONNUMERIC,
+                                    csv.QUOTE_NONE]))
+    return {
+        "delimiter": draw(st.sampled_from([",", ";", "\t", "|"])),
+        "quotechar": quotechar,
+        "escapechar": draw(st.sampled_from([None, "\\", "$"])),
+        "quoting": quoting if quotechar is not None else csv.QUOTE_NONE,
+        "doublequote": draw(st.booleans()),
+        "skipinitialspace": draw(st.booleans()),
+        "strict": draw(st.booleans()),
+    }
+
+
+@st.composite
+def inputs(draw: Any, newline: Optional[str]) -> str:
+    tokens = draw(st.lists(st.sampled_from(TOKENS + NEWLINES[newline] * 2), max_size=40))
+    return "".join(tokens)
+
+
+@pytest.mark.parametrize("newline", [None, "\n", "\r\n"], ids=["any", "lf", "crlf"])
+def test_fuzz_parsers_agree(newline: Optional[str]):
+    @hypothesis.settings(max_examples=300, deadline=None)
+    @hypothesis.given(params=dialects(), text=inputs(newline),
+                      chunks=st.lists(st.integers(1, 8), max_size=4))
+    def check(params: Dict[str, Any], text: str, chunks: List[int]) -> None:
+        # With "\r\n" line terminators, an escaped '\r' doesn't end a row at the following '\n'
+        hypothesis.assume(newline != "\r\n" or not params["escapechar"]
+                          or params["escapechar"] + "\r\n" not in text)
+        check_agreement(text, params, newline, chunks)
+
+    check()
+
+
+@pytest.mark.parametrize("text, params", [
+    ("a,", {}),
+    ('""', {}),
+    ('"a""b"', {"doublequote": False}),
+    ("a$", {"escapechar": "$"}),
+    ("a$\nb", {"escapechar": "$", "strict": True}),
+    ('"a', {"strict": True}),
+    ("\n\n", {}),
+    (" \n\n", {"skipinitialspace": True}),
+])
+def test_fuzz_regressions(text: str, params: Dict[str, Any]):
+    for newline in (None, "\n"):
+        check_agreement(text, params, newline, [1])
+        check_agreement(text, params, newline, [])
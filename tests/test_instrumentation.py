@@ -0,0 +1,196 @@
+from collections import defaultdict
+from typing import Any, Dict, List, Optional, Union
+import csv
+import io
+import pytest
+
+from aiocsv import AsyncDictReader, AsyncDictWriter, AsyncReader, AsyncWriter
+from aiocsv.instrumentation import Instrumentation, Span, set_default
+from helpers import AsyncSink
+
+DATA = "a,b\r\n1,2\r\n3,4\r\n5,6\r\n"
+ROWS = [["a", "b"], ["1", "2"], ["3", "4"], ["5", "6"]]
+
+
+class RecordedSpan(Span):
+    def __init__(self, name: str, attributes: Optional[Dict[str, Any]]) -> None:
+        self.name = name
+        self.attributes = dict(attributes or {})
+        self.ended = False
+        self.error: Optional[BaseException] = None
+
+    def set_attribute(self, key: str, value: Any) -> None:
+        self.attributes[key] = value
+
+    def end(self, error: Optional[BaseException] = None) -> None:
+        assert not self.ended
+        self.ended = True
+        self.error = error
+
+
+class Recorder(Instrumentation):
+    """Instrumentation recording everything it receives"""
+    def __init__(self) -> None:
+        self.spans: List[RecordedSpan] = []
+        self.counters: Dict[str, Union[int, float]] = defaultdict(int)
+        self.histograms: Dict[str, List[Union[int, float]]] = defaultdict(list)
+
+    def start_span(self, name: str, attributes: Optional[Dict[str, Any]] = None) -> Span:
+        span = RecordedSpan(name, attributes)
+        self.spans.append(span)
+        return span
+
+    def add(self, name: str, value: Union[int, float],
+            attributes: Optional[Dict[str, Any]] = None) -> None:
+        self.counters[name] += value
+
+    def record(self, name: str, value: Union[int, float],
+               attributes: Optional[Dict[str, Any]] = None) -> None:
+        self.histograms[name].append(value)
+
+    def named(self, name: str) -> List[RecordedSpan]:
+        return [i for i in self.spans if i.name == name]
+
+
+class AsyncSource:
+    """Simple object fulfilling WithAsyncRead over a string"""
+    def __init__(self, data: str) -> None:
+        self.data = io.StringIO(data, newline="")
+
+    async def read(self, size: int) -> str:
+        return self.data.read(size)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("lazy", [False, True], ids=["eager", "lazy"])
+async def test_reader_instrumentation(lazy: bool):
+    recorder = Recorder()
+    rows = [list(i) async for i in
+            AsyncReader(AsyncSource(DATA), lazy=lazy, instrumentation=recorder)]
+    assert rows == ROWS
+
+    read_span, = recorder.named("aiocsv.read")
+    assert read_span.ended and read_span.error is None
+    assert read_span.attributes["aiocsv.reader"] == "AsyncReader"
+    assert read_span.attributes["aiocsv.rows"] == 4
+    assert read_span.attributes["aiocsv.chars"] == len(DATA)
+
+    assert recorder.counters["aiocsv.rows_read"] == 4
+    assert recorder.counters["aiocsv.chars_read"] == len(DATA)
+    assert len(recorder.histograms["aiocsv.read.duration"]) >= 2
+
+
+@pytest.mark.asyncio
+async def test_reader_instrumentation_batches():
+    recorder = Recorder()
+    reader = AsyncReader(AsyncSource(DATA), instrumentation=recorder)
+
+    assert await reader.readbatch(3) == ROWS[:3]
+    assert await reader.readbatch(3) == ROWS[3:]
+    assert await reader.readbatch(3) == []
+
+    batches = recorder.named("aiocsv.parse_batch")
+    assert [i.attributes["aiocsv.rows"] for i in batches] == [3, 1, 0]
+    assert all(i.ended for i in batches)
+    assert recorder.counters["aiocsv.rows_read"] == 4
+    assert recorder.named("aiocsv.read")[0].ended
+
+
+@pytest.mark.asyncio
+async def test_reader_instrumentation_error():
+    recorder = Recorder()
+    reader = AsyncReader(AsyncSource('a,b\r\n"c"d\r\n'), strict=True, instrumentation=recorder)
+
+    with pytest.raises(csv.Error):
+        [i async for i in reader]
+
+    read_span, = recorder.named("aiocsv.read")
+    assert isinstance(read_span.error, csv.Error)
+    assert read_span.attributes["aiocsv.rows"] == 1
+
+
+@pytest.mark.asyncio
+async def test_dict_reader_instrumentation():
+    recorder = Recorder()
+    rows = [i async for i in AsyncDictReader(AsyncSource(DATA), instrumentation=recorder)]
+    assert rows == [{"a": "1", "b": "2"}, {"a": "3", "b": "4"}, {"a": "5", "b": "6"}]
+
+    # The header is also a read row
+    assert recorder.counters["aiocsv.rows_read"] == 4
+    read_span, = recorder.named("aiocsv.read")
+    assert read_span.ended
+    assert read_span.attributes["aiocsv.reader"] == "AsyncDictReader"
+
+
+@pytest.mark.asyncio
+async def test_cached_reader_instrumentation(tmp_path):
+    pytest.importorskip("aiocsv._parser")
+    path = tmp_path / "data.csv"
+    path.write_bytes(DATA.encode())
+
+    for chars in [len(DATA), 0]:  # cold start, then warm start
+        recorder = Recorder()
+        reader = AsyncReader.from_path(str(path), cache_dir=str(tmp_path / "cache"),
+                                       instrumentation=recorder)
+        assert [row async for row in reader] == ROWS
+
+        read_span, = recorder.named("aiocsv.read")
+        assert read_span.ended
+        assert read_span.attributes["aiocsv.rows"] == 4
+        assert read_span.attributes["aiocsv.chars"] == chars
+        assert recorder.counters["aiocsv.rows_read"] == 4
+        assert recorder.counters["aiocsv.chars_read"] == chars
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("binary", [False, True], ids=["text", "binary"])
+async def test_writer_instrumentation(binary: bool):
+    recorder = Recorder()
+    sink = AsyncSink()
+    writer = AsyncWriter(sink, binary=binary, instrumentation=recorder)
+
+    await writer.writerow(ROWS[0])
+    await writer.writerows(iter(ROWS[1:]))
+
+    unit = "bytes" if binary else "chars"
+    writes = recorder.named("aiocsv.write")
+    assert [i.attributes["aiocsv.rows"] for i in writes] == [1, 3]
+    assert [i.attributes[f"aiocsv.{unit}"] for i in writes] == [len(i) for i in sink.writes]
+    assert all(i.ended and i.error is None for i in writes)
+
+    assert recorder.counters["aiocsv.rows_written"] == 4
+    assert recorder.counters[f"aiocsv.{unit}_written"] == len(DATA)
+    assert len(recorder.histograms["aiocsv.write.duration"]) == 2
+
+
+@pytest.mark.asyncio
+async def test_dict_writer_instrumentation():
+    recorder = Recorder()
+    sink = AsyncSink()
+    writer = AsyncDictWriter(sink, ["a", "b"], instrumentation=recorder)
+
+    await writer.writeheader()
+    await writer.writerow({"a": 1, "b": 2})
+    await writer.writerows([{"a": 3, "b": 4}, {"a": 5, "b": 6}])
+
+    assert [i.attributes["aiocsv.rows"] for i in recorder.named("aiocsv.write")] == [1, 1, 2]
+    assert recorder.counters["aiocsv.rows_written"] == 4
+    assert recorder.counters["aiocsv.chars_written"] == len(DATA)
+
+
+@pytest.mark.asyncio
+async def test_default_instrumentation():
+    recorder = Recorder()
+    set_default(recorder)
+    try:
+        [i async for i in AsyncReader(AsyncSource(DATA))]
+        await AsyncWriter(AsyncSink()).writerows(ROWS)
+    finally:
+        set_default(None)
+
+    assert recorder.counters["aiocsv.rows_read"] == 4
+    assert recorder.counters["aiocsv.rows_written"] == 4
+
+    # Default no longer used
+    [i async for i in AsyncReader(AsyncSource(DATA))]
+    assert recorder.counters["aiocsv.rows_read"] == 4
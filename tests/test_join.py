@@ -0,0 +1,112 @@
+from typing import Any, List, Optional
+import csv
+import random
+import pytest
+
+from aiocsv import join, joining, load_table
+from aiocsv.testing import AdversarialSource
+from helpers import AsyncSink, rows_to_csv
+
+# Disabled for the pure-Python implementation (see conftest.py)
+PURE_PYTHON = [(joining, "JoinTable")]
+
+NAMES = ["a", "zażółć", "🦀 crab", '"quoted", name', "multi\r\nline", "", "ľ"]
+
+# Dimension table: id, name, category, unused
+TABLE_ROWS = [[str(i), random.Random(i).choice(NAMES), f"category {i % 7}", "x" * (i % 5)]
+              for i in range(300)] + [["5", "duplicate", "ignored"], [], ["300"]]
+
+
+def generate_rows(count: int) -> List[List[str]]:
+    rng = random.Random(0)
+    return [[f"order {i}", str(rng.randint(0, 320)), rng.choice(NAMES)][:rng.choice([3, 3, 1])]
+            for i in range(count)]
+
+
+ROWS = generate_rows(3000)
+
+
+def expected_join(rows: List[List[Any]], key_column: int, table_columns: List[int],
+                  inner: bool) -> List[List[Any]]:
+    table = {}
+    for row in TABLE_ROWS:
+        if row and row[0] not in table:
+            table[row[0]] = [row[i] if i < len(row) else "" for i in table_columns]
+
+    result = []
+    for row in rows:
+        key = row[key_column] if key_column < len(row) else ""
+        if row and (key in table or not inner):
+            result.append(row + table.get(key, [""] * len(table_columns)))
+    return result
+
+
+async def load(columns: List[int], mode: str = "exact",
+               header: Optional[List[str]] = None) -> Any:
+    rows = TABLE_ROWS if header is None else [header] + TABLE_ROWS
+    return await load_table(AdversarialSource(rows_to_csv(rows), mode, seed=1), [0], columns,
+                            header=header is not None)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", ["exact", "random"])
+@pytest.mark.parametrize("inner", [False, True], ids=["left", "inner"])
+async def test_join(implementation: str, mode: str, inner: bool):
+    table = await load([2, 1, 5], mode)
+    assert len(table) == 301
+
+    sink = AsyncSink()
+    written = await join(AdversarialSource(rows_to_csv(ROWS), mode, seed=2), sink, table, [1],
+                         inner=inner)
+
+    expected = expected_join(ROWS, 1, [2, 1, 5], inner)
+    assert sink.getvalue() == rows_to_csv(expected)
+    assert written == len(expected)
+
+
+@pytest.mark.asyncio
+async def test_join_header_and_dialects(implementation: str):
+    table = await load([1], header=["id", "name", "category"])
+    assert table.header == ["name"]
+    assert table.get(["7"]) == [TABLE_ROWS[7][1]]
+    assert table.get(("300",)) == [""]
+    assert table.get(["nope"]) is None
+
+    sink = AsyncSink()
+    header = ["order", "id", "note"]
+    await join(AdversarialSource(rows_to_csv([header] + ROWS), "random"), sink, table, [1],
+               header=True, dialect_out="excel-tab", binary=True)
+
+    expected = [header + ["name"]] + expected_join(ROWS, 1, [1], False)
+    assert sink.getvalue() == rows_to_csv(expected, dialect="excel-tab").encode("utf-8")
+
+
+@pytest.mark.asyncio
+async def test_join_nonnumeric(implementation: str):
+    table = await load([1])
+    sink = AsyncSink()
+    written = await join(AdversarialSource('"order",7\r\n"x","7"\r\n', "exact"), sink, table,
+                         [1], dialect_in=csv.reader("", quoting=csv.QUOTE_NONNUMERIC).dialect)
+
+    # Numbers don't match str keys of the table, quoted fields do
+    assert sink.getvalue() == rows_to_csv([["order", 7.0, ""], ["x", "7", TABLE_ROWS[7][1]]])
+    assert written == 2
+
+
+@pytest.mark.asyncio
+async def test_join_errors(implementation: str):
+    table = await load([1])
+
+    with pytest.raises(ValueError):
+        await join(AdversarialSource("a,1\r\n", "exact"), AsyncSink(), table, [0, 1])
+    with pytest.raises(ValueError):
+        await join(AdversarialSource("a,1\r\n", "exact"), AsyncSink(), table, [-1])
+    with pytest.raises(ValueError):
+        await load_table(AdversarialSource("a,1\r\n", "exact"), [0], [-1])
+
+    # Rows before invalid data are written
+    sink = AsyncSink()
+    with pytest.raises(csv.Error):
+        await join(AdversarialSource('x,7\r\n"y"z,8\r\n', "exact"), sink, table, [1],
+                   dialect_in=csv.reader("", strict=True).dialect)
+    assert sink.getvalue() == rows_to_csv([["x", "7", TABLE_ROWS[7][1]]])
@@ -0,0 +1,118 @@
+from collections.abc import Sequence
+import aiofiles
+import mmap
+import pytest
+import csv
+
+from aiocsv import AsyncReader, parse_buffer
+from aiocsv.testing import MODES, AdversarialSource
+
+DIALECT_PARAMS = {"escapechar": "$", "lineterminator": "\n"}
+FILENAME = "tests/newlines.csv"
+VALUES = [
+    ["field1", "field2", "field3"],
+    ["hello", 'is it "me"', "you're\nlooking for"],
+    ["this is going to be", "another\nbroken row", "this time with escapechar"],
+    ["and now it's both quoted\nand", "with", "escape char"]
+]
+
+
+class ChunkedSource:
+    """WithAsyncRead returning data in tiny chunks, so that rows span multiple chunks"""
+    def __init__(self, data: str, chunk_size: int) -> None:
+        self.data = data
+        self.chunk_size = chunk_size
+
+    async def read(self, _: int) -> str:
+        chunk, self.data = self.data[:self.chunk_size], self.data[self.chunk_size:]
+        return chunk
+
+
+@pytest.mark.asyncio
+async def test_lazy_read():
+    async with aiofiles.open(FILENAME, mode="r", encoding="ascii", newline="") as af:
+        read_rows = [i async for i in AsyncReader(af, lazy=True, **DIALECT_PARAMS)]
+
+    assert read_rows == VALUES
+    assert all(isinstance(i, Sequence) for i in read_rows)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("chunk_size", [1, 7, 4096])
+async def test_lazy_read_chunks(chunk_size: int):
+    with open(FILENAME, mode="r", encoding="ascii", newline="") as f:
+        source = ChunkedSource(f.read(), chunk_size)
+
+    read_rows = [i async for i in AsyncReader(source, lazy=True, **DIALECT_PARAMS)]
+    assert [list(i) for i in read_rows] == VALUES
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", MODES)
+async def test_lazy_read_adversarial(mode: str):
+    with open(FILENAME, mode="r", encoding="ascii", newline="") as f:
+        data = f.read()
+    dialect = csv.reader("", **DIALECT_PARAMS).dialect
+    source = AdversarialSource(data, mode, seed=7, dialect=dialect)
+
+    read_rows = [i async for i in AsyncReader(source, lazy=True, **DIALECT_PARAMS)]
+    assert [list(i) for i in read_rows] == VALUES
+
+
+@pytest.mark.asyncio
+async def test_lazy_row_access():
+    rows = await parse_buffer(b'"a","b""c",1\r\n', lazy=True, quoting=csv.QUOTE_NONNUMERIC)
+    row = rows[0]
+
+    assert len(row) == 3
+    assert row[1] == 'b"c'
+    assert row[-1] == 1.0
+    assert row[:2] == ["a", 'b"c']
+    assert list(row) == ["a", 'b"c', 1.0]
+
+    with pytest.raises(IndexError):
+        row[3]
+
+
+@pytest.mark.asyncio
+async def test_lazy_read_strict():
+    source = ChunkedSource('a,b\r\n"c"d,e\r\n', 3)
+    reader = AsyncReader(source, lazy=True, strict=True)
+
+    assert await reader.__anext__() == ["a", "b"]
+    with pytest.raises(csv.Error):
+        await reader.__anext__()
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("chunk_size", [1, 7, 4096])
+async def test_views_read(chunk_size: int):
+    with open(FILENAME, mode="r", encoding="ascii", newline="") as f:
+        source = ChunkedSource(f.read(), chunk_size)
+
+    read_rows = [i async for i in AsyncReader(source, views=True, **DIALECT_PARAMS)]
+    assert [[bytes(j) for j in i] for i in read_rows] == \
+        [[j.encode("utf-8") for j in i] for i in VALUES]
+
+
+@pytest.mark.asyncio
+async def test_views_buffer(tmp_path):
+    # Without the C extension, views are copies of the fields
+    pytest.importorskip("aiocsv._parser")
+    path = tmp_path / "data.csv"
+    path.write_bytes('zażółć,"gęślą ""jaźń"""\r\n'.encode("utf-8"))
+
+    with open(path, "rb") as f:
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        rows = await parse_buffer(m, views=True)
+
+        assert [[bytes(j) for j in i] for i in rows] == \
+            [["zażółć".encode("utf-8"), 'gęślą "jaźń"'.encode("utf-8")]]
+
+        # Simple fields share memory with the mmap, and keep it alive
+        assert isinstance(rows[0][0], memoryview)
+        with pytest.raises(BufferError):
+            m.close()
+
+        del rows
+        m.close()
@@ -0,0 +1,48 @@
+"""Memory footprint of readers and writers, traced with tracemalloc
+(see helpers.measure_memory, also used by benchmarks/memory.py).
+
+Readers and writers stream, so their peak memory must not grow with the number of rows.
+"""
+from typing import List
+import pytest
+
+from aiocsv import AsyncReader
+from aiocsv.testing import AdversarialSource
+from helpers import ROW_SHAPES, generate_csv, measure_memory, memory_cases
+
+# Tracing the pure-python fallback over ROWS rows of every shape takes minutes
+pytest.importorskip("aiocsv._parser")
+
+# Limit of peak memory per row (in bytes), when reading or writing ROWS rows.
+# Readers and writers need a constant amount of memory (under 150 KiB),
+# while keeping every row alive takes over 200 bytes per row.
+ROWS = 5000
+PEAK_PER_ROW = 64
+
+
+@pytest.mark.parametrize("shape", ROW_SHAPES)
+@pytest.mark.parametrize("case", ["AsyncReader", "AsyncReader(lazy)", "AsyncDictReader",
+                                  "transform", "AsyncWriter.writerow",
+                                  "AsyncWriter.writerow(binary)", "AsyncDictWriter.writerow"])
+def test_memory(shape: str, case: str):
+    footprint = measure_memory(memory_cases(shape, ROWS)[case])
+    assert footprint.rows == ROWS
+    assert footprint.peak_per_row < PEAK_PER_ROW
+    assert footprint.retained_per_row < 1
+    # Nothing allocated for the rows outlives them
+    assert footprint.blocks_per_row < 0.01
+
+
+def test_memory_catches_retained_rows():
+    data = generate_csv("narrow", ROWS)
+    kept: List[List[str]] = []
+
+    async def retain() -> int:
+        kept.extend([row async for row in AsyncReader(AdversarialSource(data, "exact"))])
+        return len(kept)
+
+    footprint = measure_memory(retain)
+    assert footprint.peak_per_row >= PEAK_PER_ROW
+    assert footprint.retained_per_row >= PEAK_PER_ROW
+    # A list and 3 strings per row
+    assert footprint.blocks_per_row >= 4
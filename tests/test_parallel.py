@@ -0,0 +1,199 @@
+from typing import Any, Dict, List
+import asyncio
+import mmap
+import pytest
+import csv
+import gc
+import io
+import sys
+import threading
+
+from aiocsv import AsyncParallelWriter, AsyncReader, parse_buffer
+import aiocsv.parallel
+from aiocsv._serializer import Serializer as FastSerializer
+from helpers import AsyncSink
+
+ROWS = [[i, f"name {i}", "ąę,\"" * (i % 3), None, i / 4] for i in range(1000)]
+
+
+class AsyncSource:
+    """Simple object fulfilling WithAsyncRead over a string"""
+    def __init__(self, data: str) -> None:
+        self.data = io.StringIO(data, newline="")
+
+    async def read(self, size: int) -> str:
+        return self.data.read(size)
+
+
+async def async_reader_output(text: str, **params) -> List[List[str]]:
+    return [row async for row in AsyncReader(AsyncSource(text), **params)]
+
+
+def csv_writer_output(rows: list, **params) -> str:
+    buffer = io.StringIO(newline="")
+    csv.writer(buffer, **params).writerows(rows)
+    return buffer.getvalue()
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("binary", [False, True], ids=["text", "binary"])
+async def test_parallel_write(binary: bool):
+    sink = AsyncSink()
+
+    async with AsyncParallelWriter(sink, binary=binary, workers=4, batch_size=64,
+                                   dialect="unix") as writer:
+        await writer.writerow(ROWS[0])
+        await writer.writerows(iter(ROWS[1:]))
+
+    expected = csv_writer_output(ROWS, dialect="unix")
+    assert len(sink.writes) == 16
+
+    if binary:
+        assert b"".join(sink.writes) == expected.encode("utf-8")  # type: ignore
+    else:
+        assert "".join(sink.writes) == expected  # type: ignore
+
+
+@pytest.mark.asyncio
+async def test_parallel_write_copies_rows():
+    sink = AsyncSink()
+    writer = AsyncParallelWriter(sink, workers=2, batch_size=10)
+
+    row = ["a", "b"]
+    await writer.writerow(row)
+    row[0] = "c"
+    await writer.writerow(row)
+    await writer.close()
+
+    assert "".join(sink.writes) == "a,b\r\nc,b\r\n"  # type: ignore
+
+
+@pytest.mark.asyncio
+async def test_parallel_write_error():
+    sink = AsyncSink()
+    writer = AsyncParallelWriter(sink, workers=2, batch_size=2, quoting=csv.QUOTE_NONE)
+
+    await writer.writerows([["a"], ["b"], ["c,d"], ["e"]])
+
+    with pytest.raises(csv.Error):
+        await writer.close()
+
+    assert sink.writes == ["a\r\nb\r\n"]
+
+    # The error isn't forgotten after it was raised once
+    with pytest.raises(csv.Error):
+        await writer.writerow(["f"])
+    with pytest.raises(csv.Error):
+        await writer.writerows([["g"]])
+    assert sink.writes == ["a\r\nb\r\n"]
+
+
+@pytest.mark.asyncio
+async def test_parallel_write_surrogates():
+    # Written to text sinks just like by AsyncWriter
+    sink = AsyncSink()
+    async with AsyncParallelWriter(sink, workers=2, batch_size=2) as writer:
+        await writer.writerows([["a\udc80"], ["ł", "b"], ["🦀\ud800"]])
+    assert sink.getvalue() == csv_writer_output([["a\udc80"], ["ł", "b"], ["🦀\ud800"]])
+
+
+@pytest.mark.asyncio
+async def test_parallel_write_failed_block():
+    sink = AsyncSink()
+    with pytest.raises(KeyError):
+        async with AsyncParallelWriter(sink, workers=2, batch_size=2) as writer:
+            await writer.writerows([["a"], ["b"], ["c"]])
+            await asyncio.sleep(0.1)
+            raise KeyError("c")
+
+    # The full batch may have been written, the pending row isn't
+    assert sink.getvalue() in ("", "a\r\nb\r\n")
+
+
+@pytest.mark.parametrize("text", [False, True], ids=["bytes", "str"])
+def test_dumps_releases_gil(text: bool):
+    # With a long switch interval, the main thread only runs while the worker thread
+    # is inside dumps if dumps releases the GIL
+    serializer = FastSerializer(csv.writer(io.StringIO()).dialect)
+    rows = [['ab"c' * 50, "d,ę" * 50] * 5] * 5000
+    started = threading.Event()
+    finished: List[bool] = []
+
+    def work() -> None:
+        started.set()
+        serializer.dumps(rows, text=text)
+        finished.append(True)
+
+    thread = threading.Thread(target=work)
+    interval = sys.getswitchinterval()
+    sys.setswitchinterval(60)
+    try:
+        thread.start()
+        started.wait()
+        ran_during_dumps = not finished
+        thread.join()
+    finally:
+        sys.setswitchinterval(interval)
+
+    assert finished == [True]
+    assert ran_during_dumps
+
+
+PARSE_TEXT = 'a,"b\r\nc",d\r\n\n"e""f",,"\n\n"\r\nłódź, "\r",1\n' * 50
+
+PARSE_DIALECTS: List[Dict[str, Any]] = [
+    {},
+    {"skipinitialspace": True},
+    {"quoting": csv.QUOTE_NONE},
+    {"escapechar": "\\", "doublequote": False},
+]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("workers", [1, 2, 3, 4])
+@pytest.mark.parametrize("params", PARSE_DIALECTS)
+async def test_parse_buffer(monkeypatch: pytest.MonkeyPatch, workers: int,
+                            params: Dict[str, Any]):
+    # Force splitting the tiny buffer into multiple segments
+    monkeypatch.setattr(aiocsv.parallel, "PARALLEL_MIN_SEGMENT", 16)
+    expected = await async_reader_output(PARSE_TEXT, **params)
+
+    assert await parse_buffer(PARSE_TEXT, workers=workers, **params) == expected
+    assert await parse_buffer(PARSE_TEXT.encode("utf-8"), workers=workers, **params) == expected
+    assert await parse_buffer(PARSE_TEXT.encode("utf-16"), workers=workers, encoding="utf-16",
+                              **params) == expected
+
+
+@pytest.mark.asyncio
+async def test_parse_buffer_mmap(tmp_path):
+    path = tmp_path / "data.csv"
+    path.write_bytes(PARSE_TEXT.encode("utf-8"))
+
+    with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+        rows = await parse_buffer(m, workers=2)
+
+    assert rows == await async_reader_output(PARSE_TEXT)
+
+
+@pytest.mark.asyncio
+async def test_parse_buffer_mmap_views(tmp_path):
+    path = tmp_path / "data.csv"
+    path.write_bytes(PARSE_TEXT.encode("utf-8"))
+
+    with open(path, "rb") as f:
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        rows = await parse_buffer(m, workers=2, views=True)
+        assert any(isinstance(field, memoryview) for row in rows for field in row)
+
+        with pytest.raises(BufferError):
+            m.close()
+
+        del rows
+        gc.collect()
+        m.close()
+
+
+@pytest.mark.asyncio
+async def test_parse_buffer_strict():
+    with pytest.raises(csv.Error):
+        await parse_buffer('a,"b"c\r\n', strict=True)
@@ -1,15 +1,21 @@
-from typing import AsyncIterator, Callable, List
+from typing import AsyncIterator, Callable, List, Optional, Tuple
 import pytest
 import csv
 import io
 
-from aiocsv._parser import parser as fast_parser
-from aiocsv.parser import parser as py_parser
+from aiocsv import AsyncReader
+from aiocsv._parser import parser as fast_parser, Profile as FastProfile, \
+    Progress as FastProgress
+from aiocsv.parser import parser as py_parser, Profile as PyProfile, Progress as PyProgress
+from aiocsv.profiling import format_report
+from aiocsv.testing import MODES, AdversarialSource
 from aiocsv.protocols import WithAsyncRead
 
 Parser = Callable[[WithAsyncRead, csv.Dialect], AsyncIterator[List[str]]]
 
 PARSERS: List[Parser] = [fast_parser, py_parser]
+PROGRESS_CLASSES = {fast_parser: FastProgress, py_parser: PyProgress}
+PROFILE_CLASSES = {fast_parser: FastProfile, py_parser: PyProfile}
 PARSER_NAMES: List[str] = ["fast_cython_parser", "pure_python_parser"]
 
 
@@ -164,3 +170,185 @@ async def test_parsing_weird_quotes_nonnumeric(parser: Parser):
     assert custom_result == [
         [3.0, ""], ["1.5", "15"], ["2", "-4.5"], [-5.2, -11.0]
     ]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_into_sent_lists(parser: Parser):
+    data = "a,b,c\r\nd\r\ne,f,g,h\r\n"
+    gen = parser(AsyncStringIO(data), csv.get_dialect("excel"))
+
+    first = await gen.__anext__()  # type: ignore
+    assert first == ["a", "b", "c"]
+
+    # Rows sent to the generator are filled with the next row
+    second = await gen.asend(first)  # type: ignore
+    assert second is first
+    assert second == ["d"]
+
+    third = await gen.asend(None)  # type: ignore
+    assert third == ["e", "f", "g", "h"]
+
+
+@pytest.mark.asyncio
+async def test_reader_readbatch():
+    data = "".join(f"{i},{i * 2}\r\n" for i in range(10))
+    reader = AsyncReader(AsyncStringIO(data))
+
+    rows = await reader.readbatch(4)
+    assert rows == [["0", "0"], ["1", "2"], ["2", "4"], ["3", "6"]]
+
+    lists = list(rows)
+    assert await reader.readbatch(4, rows) is rows
+    assert rows == [["4", "8"], ["5", "10"], ["6", "12"], ["7", "14"]]
+    assert all(i is j for i, j in zip(rows, lists))
+
+    assert await reader.readbatch(4, rows) == [["8", "16"], ["9", "18"]]
+    assert await reader.readbatch(4, rows) == []
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_newline_lf(parser: Parser):
+    data = 'a,b\r\n\nc\r,"d\ne"\n'
+    custom_result = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("excel"),
+                                             newline="\n")]  # type: ignore
+    assert custom_result == [["a", "b\r"], [], ["c\r", "d\ne"]]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_newline_crlf(parser: Parser):
+    data = 'a\rb,"c"\r\n\r\nd\n,\r\n"e\r\nf",g\r\n\r\n'
+    custom_result = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("excel"),
+                                             newline="\r\n")]  # type: ignore
+    assert custom_result == [["a\rb", "c"], [], ["d\n", ""], ["e\r\nf", "g"], []]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_newline_crlf_matches_csv(parser: Parser):
+    data = 'a,b\r\n\r\n"c\r\nd",e\r\n,\r\n'
+    csv_result = list(csv.reader(io.StringIO(data, newline="")))
+    custom_result = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("excel"),
+                                             newline="\r\n")]  # type: ignore
+    assert custom_result == csv_result
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_skip_blank_lines(parser: Parser):
+    data = "a\n\nb\n\n"
+    custom_result = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("excel"),
+                                             newline="\n", skip_blank_lines=True)]  # type: ignore
+    assert custom_result == [["a"], ["b"]]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_progress(parser: Parser):
+    data = "abcdefghi\r\n" * 1000
+    reports: List[Tuple[int, int]] = []
+    progress = PROGRESS_CLASSES[parser](lambda *args: reports.append(args), 5000)
+
+    rows = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("excel"),
+                                    progress=progress)]  # type: ignore
+
+    assert len(rows) == 1000
+    # The parser reads 2048 characters at once
+    assert len(reports) == 2
+    assert reports[0][0] == 6144 and 0 < reports[0][1] < 1000
+    assert reports[1] == (11000, 1000)
+
+
+@pytest.mark.asyncio
+async def test_reader_async_progress():
+    reports: List[Tuple[int, int]] = []
+
+    async def on_progress(chars: int, rows: int) -> None:
+        reports.append((chars, rows))
+
+    reader = AsyncReader(AsyncStringIO("a,b\r\n" * 10), on_progress=on_progress)
+    assert len([r async for r in reader]) == 10
+    assert reports == [(50, 10)]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_profile(parser: Parser):
+    data = '1,"a""b",2\r\n' * 100
+    profile = PROFILE_CLASSES[parser]()
+
+    rows = [r async for r in parser(AsyncStringIO(data), csv.get_dialect("unix"),
+                                    profile=profile)]  # type: ignore
+    assert len(rows) == 100
+    report = profile.report()
+
+    # Every char is attributed to exactly one state
+    states = ["AFTER_ROW", "AFTER_DELIM", "IN_CELL", "ESCAPE", "IN_CELL_QUOTED",
+              "ESCAPE_QUOTED", "QUOTE_IN_QUOTED", "EAT_NEWLINE"]
+    assert sum(report[i]["chars"] for i in states) == len(data)
+    assert report["QUOTE_IN_QUOTED"]["chars"] == 200
+    assert report["QUOTE_IN_QUOTED"]["count"] == 200
+    assert report["IN_CELL_QUOTED"]["chars"] == 400
+    # ("\n", and the first char of the next row)
+    assert report["EAT_NEWLINE"]["chars"] == 199
+
+    assert report["read"]["chars"] == len(data)
+    assert report["consumer"]["count"] == 100
+    assert report["float"]["count"] == 0
+    assert all(i["seconds"] >= 0 for i in report.values())
+    assert "QUOTE_IN_QUOTED" in format_report(report)
+
+
+@pytest.mark.asyncio
+async def test_reader_profile_nonnumeric():
+    profile = FastProfile()
+    reader = AsyncReader(AsyncStringIO('1.5,"a"\r\n' * 10), quoting=csv.QUOTE_NONNUMERIC,
+                         profile=profile)
+    assert [r async for r in reader] == [[1.5, "a"]] * 10
+
+    report = profile.report()
+    assert report["float"]["count"] == 10
+    assert report["float"]["chars"] == 30
+
+
+ADVERSARIAL_DATA = 'a,"b""c",d\r\n"e\r\nf","",g$,h\r\n"""",i$$,"j""\r\n""k"\r\n,,\r\n'
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", MODES)
+@pytest.mark.parametrize("newline", [None, "\r\n"], ids=["any", "crlf"])
+@pytest.mark.parametrize("parser", PARSERS, ids=PARSER_NAMES)
+async def test_parsing_adversarial_reads(parser: Parser, newline: Optional[str], mode: str):
+    dialect = csv.reader("", escapechar="$").dialect
+    source = AdversarialSource(ADVERSARIAL_DATA * 50, mode, seed=42, dialect=dialect)
+
+    csv_result = list(csv.reader(io.StringIO(ADVERSARIAL_DATA * 50, newline=""), dialect))
+    custom_result = [r async for r in parser(source, dialect, newline=newline)]  # type: ignore
+
+    assert custom_result == csv_result
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", MODES)
+async def test_adversarial_source(mode: str):
+    dialect = csv.reader("", escapechar="$").dialect
+    source = AdversarialSource(ADVERSARIAL_DATA, mode, max_read=4, seed=1, dialect=dialect)
+    chunks = []
+    while True:
+        chunk = await source.read(8)
+        if not chunk:
+            break
+        chunks.append(chunk)
+
+    assert "".join(chunks) == ADVERSARIAL_DATA
+    assert all(len(i) <= 8 for i in chunks)
+
+    ends = {i[-1] + j[0] for i, j in zip(chunks, chunks[1:])}
+    if mode == "single":
+        assert all(len(i) == 1 for i in chunks)
+    elif mode == "random":
+        assert all(len(i) <= 4 for i in chunks)
+    elif mode == "pairs":
+        assert {"\r\n", '""', "$,", "$$"} <= ends
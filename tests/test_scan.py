@@ -0,0 +1,173 @@
+from typing import Any, Dict, List, Optional
+import csv
+import io
+import os
+import random
+import subprocess
+import sys
+import pytest
+
+from aiocsv import AsyncReader
+from aiocsv._parser import BufferIndex, Source, select_simd_variant, simd_variant, simd_variants
+from helpers import rows_to_csv
+
+ROOT = os.path.join(os.path.dirname(__file__), "..")
+
+# Fields long enough to span blocks of the scanning kernels, made of characters
+# special to some of the dialects
+PIECES = ["a", "b", "x" * 17, "y" * 70, ",", ";", '"', "'", "\\", "\r\n", "\n", " "]
+EXTRA = {"latin-1": "é", "ucs-2": "ł", "ucs-4": "🦀"}
+
+DIALECTS: Dict[str, Dict[str, Any]] = {
+    "excel": {},
+    "all": {"quoting": csv.QUOTE_ALL},
+    "escape": {"escapechar": "\\", "doublequote": False},
+    "none": {"quoting": csv.QUOTE_NONE, "escapechar": "\\"},
+    "semicolon": {"delimiter": ";", "quotechar": "'"},
+}
+
+
+def generate_rows(count: int, extra: str) -> List[List[str]]:
+    rng = random.Random(count)
+    pieces = PIECES + [extra * 5]
+    return [["".join(rng.choice(pieces) for _ in range(rng.randint(1, 12)))
+             for _ in range(rng.randint(1, 5))] for _ in range(count)]
+
+
+def index_rows(obj: Any, params: Dict[str, Any]) -> List[List[str]]:
+    dialect = csv.reader("", **params).dialect
+    source = Source(obj, "utf-8", dialect)
+    index = BufferIndex(source, dialect)
+    index.index(0, source.length)
+    index.finish()
+    return index.materialize()
+
+
+class StringSource:
+    def __init__(self, data: str) -> None:
+        self.data = io.StringIO(data, newline="")
+
+    async def read(self, size: int) -> str:
+        return self.data.read(size)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("dialect", DIALECTS)
+@pytest.mark.parametrize("kind", EXTRA)
+async def test_long_fields(dialect: str, kind: str):
+    params = DIALECTS[dialect]
+    data = rows_to_csv(generate_rows(300, EXTRA[kind]), **params)
+    expected = list(csv.reader(io.StringIO(data, newline=""), **params))
+
+    assert index_rows(data, params) == expected
+    assert index_rows(data.encode("utf-8"), params) == expected
+    assert [row async for row in AsyncReader(StringSource(data), **params)] == expected
+    lazy = AsyncReader(StringSource(data), lazy=True, **params)
+    assert [list(row) async for row in lazy] == expected
+
+
+@pytest.mark.parametrize("strict", [False, True])
+def test_malformed_quotes(strict: bool):
+    # Quotes in the middle of fields, and unterminated quoted fields, across blocks
+    data = ("a" * 40 + '"b"' + "c" * 40 + ',"' + "d" * 70 + '"e' + "f" * 30 + "\r\n") * 3
+    data += '"' + "g" * 100
+    params = {"strict": strict}
+
+    try:
+        expected: Any = list(csv.reader(io.StringIO(data, newline=""), **params))
+    except csv.Error:
+        expected = csv.Error
+
+    for obj in [data, data.encode("utf-8")]:
+        try:
+            assert index_rows(obj, params) == expected
+        except csv.Error:
+            assert expected is csv.Error
+
+
+def reference_find_row_start(text: str, start: int, end: int, quote: Optional[str],
+                             odd: bool) -> int:
+    i = start
+    after_newline = False
+    while i < len(text) and (i < end or after_newline):
+        c = text[i]
+        if c in "\r\n":
+            after_newline = after_newline or not odd
+        elif after_newline:
+            break
+        elif c == quote:
+            odd = not odd
+        i += 1
+    return i if after_newline and i < len(text) else -1
+
+
+@pytest.mark.parametrize("extra", ["é", "ł", "🦀"])
+@pytest.mark.parametrize("encode", [False, True], ids=["str", "utf-8"])
+def test_quote_parity(extra: str, encode: bool):
+    rng = random.Random(1)
+    text = "".join(rng.choice(["a" * rng.randint(1, 90), '"', "\r\n", "\n", extra, ","])
+                   for _ in range(2000))
+    dialect = csv.reader("").dialect
+    source = Source(text.encode("utf-8") if encode else text, "utf-8", dialect)
+    # Positions in the encoded source are positions of bytes
+    units = text.encode("utf-8").decode("latin-1") if encode else text
+
+    for _ in range(300):
+        start = rng.randrange(len(units))
+        end = rng.randint(start, len(units))
+        odd = units[:start].count('"') % 2 == 1
+        assert source.count_quotes(start, end, '"') == units[start:end].count('"')
+        for quote in ['"', None]:
+            assert source.find_row_start(start, end, quote, odd) \
+                == reference_find_row_start(units, start, end, quote, odd)
+
+
+@pytest.fixture(params=simd_variants())
+def variant(request):
+    select_simd_variant(request.param)
+    yield request.param
+    select_simd_variant()
+
+
+@pytest.mark.parametrize("dialect", DIALECTS)
+def test_variants(variant: str, dialect: str):
+    assert simd_variant() == variant
+    params = DIALECTS[dialect]
+    data = rows_to_csv(generate_rows(200, "é"), **params)
+    expected = list(csv.reader(io.StringIO(data, newline=""), **params))
+    assert index_rows(data, params) == expected
+    assert index_rows(data.encode("utf-8"), params) == expected
+
+    # Fewer, longer lines, so that most of the splitting is done in blocks
+    data = rows_to_csv([[f"{i}" * i, f'"{i}",\n'] for i in range(200)], **params)
+    source = Source(data, "utf-8", csv.reader("", **params).dialect)
+    for start in range(0, len(data), 97):
+        assert source.count_quotes(start, len(data), '"') == data[start:].count('"')
+        assert source.find_row_start(start, start + 200, '"', False) \
+            == reference_find_row_start(data, start, start + 200, '"', False)
+
+
+def import_with_simd_env(value: str) -> "subprocess.CompletedProcess[str]":
+    code = "from aiocsv._parser import simd_variant; print(simd_variant())"
+    return subprocess.run([sys.executable, "-c", code], cwd=ROOT, check=True,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True,
+                          env={**os.environ, "AIOCSV_SIMD": value})
+
+
+def test_select_variant():
+    # AIOCSV_SIMD may be set for this process
+    select_simd_variant()
+    assert simd_variants()[0] == "c"
+    assert simd_variant() == simd_variants()[-1]
+
+    with pytest.raises(ValueError, match="unknown"):
+        select_simd_variant("mmx")
+    assert simd_variant() == simd_variants()[-1]
+
+    # Forced at import with an environment variable
+    assert import_with_simd_env("c").stdout.strip() == "c"
+
+    # An invalid one is ignored with a warning
+    result = import_with_simd_env("mmx")
+    assert result.stdout.strip() == simd_variants()[-1]
+    assert "RuntimeWarning: ignoring AIOCSV_SIMD: unknown SIMD variant 'mmx'" in result.stderr
@@ -0,0 +1,143 @@
+from tempfile import NamedTemporaryFile
+from typing import Any, Dict, List, Type
+import aiofiles
+import pytest
+import csv
+import io
+import os
+
+from aiocsv import AsyncWriter, AsyncDictWriter
+from aiocsv._serializer import Serializer as FastSerializer
+from aiocsv.serializer import Serializer as PySerializer
+from helpers import AsyncSink
+
+SERIALIZERS: List[Type[Any]] = [FastSerializer, PySerializer]
+SERIALIZER_NAMES: List[str] = ["fast_cython_serializer", "pure_python_serializer"]
+
+ROWS: List[List[Any]] = [
+    ["abc", 'd"e', "f,g", "h\r\ni"],
+    ["zażółć", "gęślą", "jaźń", "🦀"],
+    [1, 2.5, -3, None],
+    [""],
+    [None],
+    [],
+    ["$", " x ", "'"],
+]
+
+DIALECTS: List[Dict[str, Any]] = [
+    {},
+    {"dialect": "unix"},
+    {"delimiter": "\t", "quotechar": "'", "quoting": csv.QUOTE_ALL},
+    {"quoting": csv.QUOTE_NONNUMERIC, "lineterminator": "\n"},
+    {"escapechar": "$", "doublequote": False},
+    {"delimiter": "€", "quotechar": "ł"},
+]
+
+
+def csv_writer_text(rows: List[List[Any]], **params: Any) -> str:
+    buffer = io.StringIO(newline="")
+    csv.writer(buffer, **params).writerows(rows)
+    return buffer.getvalue()
+
+
+def csv_writer_output(rows: List[List[Any]], **params: Any) -> bytes:
+    return csv_writer_text(rows, **params).encode("utf-8")
+
+
+@pytest.mark.parametrize("serializer", SERIALIZERS, ids=SERIALIZER_NAMES)
+@pytest.mark.parametrize("params", DIALECTS)
+def test_serializer_matches_csv(serializer: Type[Any], params: Dict[str, Any]):
+    s = serializer(csv.writer(io.StringIO(), **params).dialect)
+    s.writerow(ROWS[0])
+    s.writerows(ROWS[1:])
+
+    assert bytes(s.getbuffer()) == csv_writer_output(ROWS, **params)
+
+
+@pytest.mark.parametrize("serializer", SERIALIZERS, ids=SERIALIZER_NAMES)
+@pytest.mark.parametrize("params", DIALECTS + [{"delimiter": ";", "quotechar": "ł"}])
+def test_serializer_dumps(serializer: Type[Any], params: Dict[str, Any]):
+    s = serializer(csv.writer(io.StringIO(), **params).dialect)
+    assert s.dumps(ROWS) == csv_writer_output(ROWS, **params)
+
+    # str output has to be created with the exact kind of its contents,
+    # or it wouldn't compare equal - so every row is checked on its own too
+    rows = ROWS + [["é", "b"], ["Ā"], ["x\udc80y", "z"]]
+    for batch in [rows] + [[row] for row in rows]:
+        assert s.dumps(batch, text=True) == csv_writer_text(batch, **params)
+
+
+@pytest.mark.parametrize("serializer", SERIALIZERS, ids=SERIALIZER_NAMES)
+def test_serializer_quote_none(serializer: Type[Any]):
+    s = serializer(csv.writer(io.StringIO(), quoting=csv.QUOTE_NONE, escapechar="\\").dialect)
+    s.writerow(['a,b', 'c"d', "e\\f"])
+    assert bytes(s.getbuffer()) == b'a\\,b,c\\"d,e\\\\f\r\n'
+
+    s = serializer(csv.writer(io.StringIO(), quoting=csv.QUOTE_NONE).dialect)
+    with pytest.raises(csv.Error):
+        s.writerow(["a,b"])
+    with pytest.raises(csv.Error):
+        s.writerow([""])
+    assert s.used == 0
+
+
+@pytest.mark.parametrize("serializer", SERIALIZERS, ids=SERIALIZER_NAMES)
+def test_serializer_reuses_buffer(serializer: Type[Any]):
+    s = serializer(csv.get_dialect("excel"))
+    s.writerows([["x" * 100]] * 100)
+    capacity = len(s.buffer)
+
+    s.clear()
+    s.writerows([["y" * 100]] * 100)
+    assert len(s.buffer) == capacity
+    assert bytes(s.getbuffer()) == (b"y" * 100 + b"\r\n") * 100
+
+
+@pytest.mark.parametrize("serializer", SERIALIZERS, ids=SERIALIZER_NAMES)
+def test_serializer_invalid_rows(serializer: Type[Any]):
+    s = serializer(csv.get_dialect("excel"))
+
+    with pytest.raises(csv.Error):
+        s.writerow(1)
+
+    with pytest.raises(UnicodeEncodeError):
+        s.writerow(["a", "\udc80"])
+
+
+@pytest.mark.asyncio
+async def test_binary_write():
+    with NamedTemporaryFile(mode="w+", suffix=".csv", delete=False) as tf:
+        target_name = tf.name
+
+    try:
+        async with aiofiles.open(target_name, mode="wb") as afp:
+            writer = AsyncWriter(afp, binary=True)
+            await writer.writerow(ROWS[0])
+            await writer.writerows(ROWS[1:])
+
+            dict_writer = AsyncDictWriter(afp, ["a", "b"], binary=True, restval="-")
+            await dict_writer.writeheader()
+            await dict_writer.writerows([{"a": "ą"}, {"b": 1}])
+
+            with pytest.raises(ValueError):
+                await dict_writer.writerow({"c": 2})
+
+        with open(target_name, mode="rb") as created_f:
+            created = created_f.read()
+
+        assert created == csv_writer_output(ROWS + [["a", "b"], ["ą", "-"], ["-", 1]])
+
+    finally:
+        os.remove(target_name)
+
+
+@pytest.mark.asyncio
+async def test_binary_write_kept():
+    # The file may keep the written objects, which mustn't change on later writes
+    sink = AsyncSink()
+    writer = AsyncWriter(sink, binary=True)
+    for row in ROWS:
+        await writer.writerow(row)
+
+    assert sink.getvalue() == csv_writer_output(ROWS)
+    assert all(isinstance(i, bytes) for i in sink.writes)
@@ -0,0 +1,114 @@
+from typing import Any, List
+import csv
+import gc
+import io
+import random
+from concurrent.futures import ThreadPoolExecutor
+import pytest
+
+from aiocsv import sort, sorting
+from aiocsv.testing import AdversarialSource
+from helpers import AsyncSink, rows_to_csv
+
+# Disabled for the pure-Python implementation (see conftest.py)
+PURE_PYTHON = [(sorting, "index_chunks")]
+
+# Small enough to split ROWS into many runs
+SMALL_MEMORY_LIMIT = 20000
+
+
+def generate_rows(count: int) -> List[List[str]]:
+    rng = random.Random(0)
+    return [[str(rng.randint(0, 50)), f"name {i}", f'"quoted", {i}', rng.choice("abcł🦀")]
+            for i in range(count)]
+
+
+ROWS = generate_rows(3000)
+
+
+async def run_sort(data: str, binary: bool = False, **kwargs: Any) -> Any:
+    sink = AsyncSink()
+    written = await sort(AdversarialSource(data, "exact"), sink, binary=binary, **kwargs)
+    output = sink.getvalue()
+    text = output.decode() if isinstance(output, bytes) else output
+    assert written == len(list(csv.reader(io.StringIO(text, newline=""),
+                                          kwargs.get("dialect_out", "excel"))))
+    return output
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("memory_limit", [1 << 26, SMALL_MEMORY_LIMIT], ids=["memory", "runs"])
+@pytest.mark.parametrize("reverse", [False, True], ids=["asc", "desc"])
+async def test_sort(implementation: str, memory_limit: int, reverse: bool):
+    output = await run_sort(rows_to_csv(ROWS), key_columns=[0], memory_limit=memory_limit,
+                            reverse=reverse, workers=3)
+
+    # Python's sort is stable, just like aiocsv.sort
+    assert output == rows_to_csv(sorted(ROWS, key=lambda row: row[0], reverse=reverse))
+
+
+@pytest.mark.asyncio
+async def test_sort_key_and_header(implementation: str):
+    header = ["number", "name", "quoted", "letter"]
+    output = await run_sort(
+        rows_to_csv([header] + ROWS), key_columns=[3, 0],
+        key=lambda fields: (fields[0], int(fields[1])), header=True,
+        memory_limit=SMALL_MEMORY_LIMIT, dialect_out="excel-tab", binary=True,
+    )
+
+    expected = [header] + sorted(ROWS, key=lambda row: (row[3], int(row[0])))
+    assert output == rows_to_csv(expected, dialect="excel-tab").encode("utf-8")
+
+
+@pytest.mark.asyncio
+async def test_sort_numeric(implementation: str):
+    rows = [[random.Random(i).random() * 100 - 50, f"row {i}"] for i in range(2000)]
+    dialect = csv.reader("", quoting=csv.QUOTE_NONNUMERIC).dialect
+
+    output = await run_sort(rows_to_csv(rows, quoting=csv.QUOTE_NONNUMERIC), key_columns=[0],
+                            memory_limit=SMALL_MEMORY_LIMIT, dialect_in=dialect,
+                            dialect_out=dialect)
+    assert output == rows_to_csv(sorted(rows), quoting=csv.QUOTE_NONNUMERIC)
+
+
+@pytest.mark.asyncio
+async def test_sort_missing_fields(implementation: str):
+    output = await run_sort("b,1\r\na\r\n\r\nc,0\r\n,2\r\n", key_columns=[1])
+    assert output == "a\r\nc,0\r\nb,1\r\n,2\r\n"
+
+    with pytest.raises(ValueError):
+        await run_sort("a\r\n", key_columns=[])
+    with pytest.raises(ValueError):
+        await run_sort("a\r\n", key_columns=[-1])
+
+
+@pytest.mark.asyncio
+async def test_sort_runs_on_executor(implementation: str):
+    submitted: List[Any] = []
+
+    class RecordingExecutor(ThreadPoolExecutor):
+        def submit(self, fn: Any, *args: Any, **kwargs: Any) -> Any:
+            submitted.append(fn)
+            return super().submit(fn, *args, **kwargs)
+
+    with RecordingExecutor(2) as executor:
+        output = await run_sort(rows_to_csv(ROWS), key_columns=[0],
+                                memory_limit=SMALL_MEMORY_LIMIT, executor=executor)
+
+    assert output == rows_to_csv(sorted(ROWS, key=lambda row: row[0]))
+    # Run files are written (and read back) off the event loop
+    assert len(submitted) > 2
+
+
+@pytest.mark.asyncio
+async def test_sort_key_error(implementation: str, caplog: pytest.LogCaptureFixture):
+    def key(fields: List[str]) -> int:
+        raise KeyError(fields[0])
+
+    with pytest.raises(KeyError):
+        await run_sort(rows_to_csv(ROWS), key_columns=[0], key=key,
+                       memory_limit=SMALL_MEMORY_LIMIT, workers=3)
+
+    # Errors of all runs are retrieved
+    gc.collect()
+    assert "never retrieved" not in caplog.text
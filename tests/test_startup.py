@@ -0,0 +1,41 @@
+import os
+import subprocess
+import sys
+import pytest
+
+import aiocsv
+
+ROOT = os.path.join(os.path.dirname(__file__), "..")
+
+
+def imported_after(code: str) -> set:
+    """Returns names of modules imported in a fresh interpreter after running `code`"""
+    output = subprocess.run([sys.executable, "-c", f"{code}\nimport sys\nprint(*sys.modules)"],
+                            cwd=ROOT, check=True, stdout=subprocess.PIPE,
+                            universal_newlines=True).stdout
+    return set(output.split())
+
+
+def test_import_is_lazy():
+    modules = imported_after("import aiocsv")
+    assert "aiocsv.readers" not in modules
+    assert "typing" not in modules or "typing" in imported_after("pass")
+
+
+@pytest.mark.parametrize("name, other", [("AsyncReader", "aiocsv.writers"),
+                                         ("AsyncWriter", "aiocsv.readers")])
+def test_reader_imports(name: str, other: str):
+    modules = imported_after(f"from aiocsv import {name}")
+    for module in ["asyncio", "concurrent.futures", "inspect", "aiocsv.cache", "aiocsv.streams",
+                   other]:
+        assert module not in modules
+
+
+def test_exports():
+    for name in aiocsv.__all__:
+        assert getattr(aiocsv, name) is not None
+        assert name in dir(aiocsv)
+    assert aiocsv.AsyncReader.__module__ == "aiocsv.readers"
+
+    with pytest.raises(AttributeError):
+        aiocsv.no_such_name
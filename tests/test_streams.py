@@ -0,0 +1,133 @@
+from typing import List
+import asyncio
+import pytest
+
+from aiocsv import AsyncReader
+from aiocsv.streams import AsyncTransportWriter, CsvStreamProtocol, CsvWriterProtocol, \
+    open_connection
+
+DATA = 'name,city\r\nŁukasz,"Łódź, PL"\r\nZoë,Zürich\r\n'.encode("utf-8")
+VALUES = [["name", "city"], ["Łukasz", "Łódź, PL"], ["Zoë", "Zürich"]]
+
+
+def feed(protocol: CsvStreamProtocol, data: bytes, chunk_size: int) -> None:
+    for i in range(0, len(data), chunk_size):
+        chunk = data[i:i + chunk_size]
+        buf = protocol.get_buffer(-1)
+        buf[:len(chunk)] = chunk
+        protocol.buffer_updated(len(chunk))
+    protocol.eof_received()
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("encoding", ["utf-8", "utf-16"])
+@pytest.mark.parametrize("chunk_size", [1, 3, 1024])
+async def test_protocol_split_characters(encoding: str, chunk_size: int):
+    protocol = CsvStreamProtocol(encoding=encoding)
+    feed(protocol, DATA.decode("utf-8").encode(encoding), chunk_size)
+
+    read_rows = [i async for i in AsyncReader(protocol)]
+    assert read_rows == VALUES
+
+
+@pytest.mark.asyncio
+async def test_protocol_data_received():
+    # Event loops of Python 3.6 don't know BufferedProtocol
+    protocol = CsvStreamProtocol(buffer_size=4)
+    protocol.data_received(DATA[:7])
+    protocol.data_received(DATA[7:])
+    protocol.eof_received()
+
+    read_rows = [i async for i in AsyncReader(protocol)]
+    assert read_rows == VALUES
+
+
+@pytest.mark.asyncio
+async def test_protocol_connection_lost():
+    protocol = CsvStreamProtocol()
+    protocol.buffer_updated(0)
+    protocol.connection_lost(ConnectionResetError())
+
+    with pytest.raises(ConnectionResetError):
+        await protocol.read(10)
+
+
+@pytest.mark.asyncio
+async def test_open_connection():
+    async def serve(_: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        for i in range(0, len(DATA), 7):
+            writer.write(DATA[i:i + 7])
+            await writer.drain()
+        writer.close()
+
+    server = await asyncio.start_server(serve, "127.0.0.1", 0)
+    port = server.sockets[0].getsockname()[1]
+
+    async with server:
+        protocol = await open_connection("127.0.0.1", port, buffer_size=16)
+        read_rows = [i async for i in AsyncReader(protocol)]
+        assert read_rows == VALUES
+
+
+class FakeTransport(asyncio.WriteTransport):
+    def __init__(self) -> None:
+        super().__init__()
+        self.writes: List[List[bytes]] = []
+
+    def writelines(self, list_of_data) -> None:
+        self.writes.append(list(list_of_data))
+
+
+@pytest.mark.asyncio
+async def test_transport_writer_batches():
+    transport = FakeTransport()
+    protocol = CsvWriterProtocol()
+    protocol.connection_made(transport)
+    writer = AsyncTransportWriter(transport, protocol, buffer_size=16)
+
+    await writer.writerow(VALUES[0])
+    assert transport.writes == []
+
+    await writer.writerows(VALUES[1:])
+    assert len(transport.writes) == 1
+    assert all(len(chunk) >= 16 for chunk in transport.writes[0][:-1])
+
+    await writer.flush()
+    assert b"".join(b"".join(i) for i in transport.writes) == DATA
+
+
+@pytest.mark.asyncio
+async def test_transport_writer_flow_control():
+    transport = FakeTransport()
+    protocol = CsvWriterProtocol()
+    protocol.connection_made(transport)
+    writer = AsyncTransportWriter(transport, protocol)
+
+    protocol.pause_writing()
+    task = asyncio.ensure_future(writer.writerows(VALUES))
+    await asyncio.sleep(0)
+    assert not task.done()
+
+    protocol.resume_writing()
+    await task
+    assert b"".join(transport.writes[0]) == DATA
+
+
+@pytest.mark.asyncio
+async def test_transport_writer_stream_writer():
+    received = asyncio.get_event_loop().create_future()
+
+    async def serve(reader: asyncio.StreamReader, _: asyncio.StreamWriter) -> None:
+        received.set_result(await reader.read())
+
+    server = await asyncio.start_server(serve, "127.0.0.1", 0)
+    port = server.sockets[0].getsockname()[1]
+
+    async with server:
+        _, stream_writer = await asyncio.open_connection("127.0.0.1", port)
+        writer = AsyncTransportWriter(stream_writer.transport, stream_writer, buffer_size=8)
+        await writer.writerows(VALUES)
+        await writer.flush()
+        stream_writer.close()
+
+        assert await received == DATA
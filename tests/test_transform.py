@@ -0,0 +1,95 @@
+from typing import Any, Dict, List, Optional, Sequence, Union
+import csv
+import io
+import pytest
+
+from aiocsv import pipeline, transform
+from aiocsv.testing import AdversarialSource
+from helpers import AsyncSink
+
+# Disabled for the pure-Python implementation (see conftest.py)
+PURE_PYTHON = [(pipeline, "index_chunks")]
+
+DATA = (
+    'id,name,"note, with comma",value\r\n'
+    '1,zażółć,"a ""quoted"" word",2.5\r\n'
+    '2,"multi\r\nline",plain,-3\r\n'
+    "3,🦀,,\r\n"
+    "4\r\n"
+    '"",x,"$",\' \'\r\n'
+)
+
+# Data for QUOTE_NONNUMERIC readers
+NUMERIC_DATA = '"id","name","value"\r\n1,"a ""b"", c",2.5\r\n2,"",-3\r\n'
+
+DIALECT_PAIRS: List[Dict[str, Any]] = [
+    {},
+    {"out": {"dialect": "unix"}},
+    {"out": {"delimiter": "\t", "quotechar": "'", "quoting": csv.QUOTE_ALL}},
+    {"out": {"delimiter": ";", "escapechar": "$", "doublequote": False}},
+    {"out": {"delimiter": "€", "quotechar": "ł", "lineterminator": "\n"}},
+    {"in": {"quoting": csv.QUOTE_NONNUMERIC}, "out": {"quoting": csv.QUOTE_NONNUMERIC}},
+    {"in": {"escapechar": "$"}, "out": {"quoting": csv.QUOTE_NONE, "escapechar": "\\"}},
+]
+
+
+def expected_output(data: str, select: Optional[Sequence[int]], params_in: Dict[str, Any],
+                    params_out: Dict[str, Any]) -> str:
+    output = io.StringIO(newline="")
+    writer = csv.writer(output, **params_out)
+    for row in csv.reader(io.StringIO(data, newline=""), **params_in):
+        if select is not None and row:
+            row = [row[i] if i < len(row) else "" for i in select]
+        writer.writerow(row)
+    return output.getvalue()
+
+
+async def run_transform(data: str, binary: bool = False, mode: str = "exact",
+                        **kwargs: Any) -> Union[str, bytes]:
+    sink = AsyncSink()
+    rows = await transform(AdversarialSource(data, mode, seed=0), sink, binary=binary, **kwargs)
+    assert rows == len(list(csv.reader(io.StringIO(data, newline=""), kwargs["dialect_in"])))
+    return sink.getvalue()
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("params", DIALECT_PAIRS)
+@pytest.mark.parametrize("select", [None, [3, 1], [0, 0, 5]], ids=["all", "reorder", "missing"])
+async def test_transform_matches_csv(implementation: str, params: Dict[str, Any],
+                                     select: Optional[List[int]]):
+    params_in = params.get("in", {})
+    params_out = params.get("out", {})
+    data = NUMERIC_DATA if params_in.get("quoting") == csv.QUOTE_NONNUMERIC else DATA
+
+    output = await run_transform(
+        data, select=select,
+        dialect_in=csv.reader("", **params_in).dialect,
+        dialect_out=csv.writer(io.StringIO(), **params_out).dialect,
+    )
+    assert output == expected_output(data, select, params_in, params_out)
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize("mode", ["single", "pairs", "random"])
+async def test_transform_short_reads(implementation: str, mode: str):
+    output = await run_transform(DATA * 20, mode=mode, select=[2, 0], dialect_in="excel",
+                                 dialect_out="unix", binary=True)
+    assert output == expected_output(DATA * 20, [2, 0], {}, {"dialect": "unix"}).encode()
+
+
+@pytest.mark.asyncio
+async def test_transform_errors(implementation: str):
+    with pytest.raises(csv.Error):
+        await run_transform('"a,b",c\r\n', dialect_in="excel",
+                            dialect_out=csv.writer(io.StringIO(),
+                                                   quoting=csv.QUOTE_NONE).dialect)
+
+    with pytest.raises(ValueError):
+        await run_transform("a,b\r\n", dialect_in="excel", dialect_out="excel", select=[-1])
+
+    # Rows before invalid data are copied
+    sink = AsyncSink()
+    with pytest.raises(csv.Error):
+        await transform(AdversarialSource('a,b\r\n"c"d\r\n', "exact"), sink,
+                        dialect_in=csv.reader("", strict=True).dialect)
+    assert sink.getvalue() == "a,b\r\n"